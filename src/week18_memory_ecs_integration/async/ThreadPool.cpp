@@ -2,28 +2,44 @@
 
 #include <iostream>
 
-ThreadPool::ThreadPool(std::size_t count, std::size_t queueCapacity = 1024) {
+#include "../tasks/Profiler.hpp"
+
+ThreadPool::ThreadPool(std::size_t count, std::size_t queueCapacity, std::function<void(size_t)> onThreadStart) {
   _queues.reserve(count);
   for (size_t i = 0; i < count; ++i) {
     _queues.emplace_back(std::make_unique<LockFreeQueue<Job<>>>(queueCapacity));
   }
-  start(count);
+  start(count, onThreadStart);
 }
 
 ThreadPool::~ThreadPool() {
   stop();
 }
 
-void ThreadPool::start(std::size_t count) {
+void ThreadPool::start(std::size_t count, const std::function<void(size_t)>& onThreadStart) {
   for (std::size_t i = 0; i < count; ++i) {
-    _threads.emplace_back([this, i] {
+    _threads.emplace_back([this, i, onThreadStart] {
       try {
+        if (onThreadStart) {
+          onThreadStart(i);
+        }
+        // Time spent spinning for work is recorded as one idle event per stretch
+        uint64_t idleSince = 0;
+        bool idle = false;
         while (_queues[i]->is_valid()) {
           Job job;
-          if (_queues[i]->try_dequeue(job)) {
+          if (_queues[i]->try_dequeue(job) || trySteal(i, job)) {
+            if (idle) {
+              Profiler::instance().record(ProfileCategory::Idle, "Idle", idleSince, Profiler::now());
+              idle = false;
+            }
             job();
             _activeJobs.fetch_sub(1, std::memory_order_release);
           } else {
+            if (!idle && Profiler::enabled()) {
+              idle = true;
+              idleSince = Profiler::now();
+            }
             std::this_thread::yield();
           }
         }
@@ -44,7 +60,20 @@ void ThreadPool::enqueue(Job<>&& job) {
   }
 }
 
+bool ThreadPool::runPendingJob() {
+  Job job;
+  // The caller is not a worker, so every queue is a candidate
+  if (!trySteal(_queues.size(), job)) {
+    return false;
+  }
+  job();
+  _activeJobs.fetch_sub(1, std::memory_order_release);
+  return true;
+}
+
 void ThreadPool::waitForIdle() {
+  if (_activeJobs.load(std::memory_order_acquire) == 0) return;
+  ProfileScope scope(ProfileCategory::Idle, "Wait");
   while (_activeJobs.load(std::memory_order_acquire) > 0) {
     std::this_thread::yield();
   }
@@ -61,16 +90,20 @@ void ThreadPool::stop() {
   _threads.clear();
 }
 
+size_t ThreadPool::workerCount() const {
+  return _threads.size();
+}
+
 size_t ThreadPool::getLeastLoadedQueue() const {
   if (_threads.size() == 1) {
     return 0;
   }
 
   size_t idx = 0;
-  size_t smallest = _queues[0]->capacity();
+  size_t smallest = _queues[0]->size_approx();
   for (size_t i = 1; i < _threads.size(); ++i) {
-    if (_queues[i]->capacity() < smallest) {
-      smallest = _queues[i]->capacity();
+    if (_queues[i]->size_approx() < smallest) {
+      smallest = _queues[i]->size_approx();
       idx = i;
     }
   }
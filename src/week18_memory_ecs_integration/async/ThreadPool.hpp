@@ -13,7 +13,10 @@
 
 class ThreadPool {
  public:
-  explicit ThreadPool(std::size_t count, std::size_t queueCapacity);
+  // onThreadStart(workerIndex) runs on each worker before it starts taking jobs,
+  // e.g. to bind thread local state such as the worker's frame arena
+  explicit ThreadPool(std::size_t count, std::size_t queueCapacity,
+                      std::function<void(size_t)> onThreadStart = {});
   ~ThreadPool();
 
   ThreadPool(const ThreadPool&) = delete;
@@ -24,8 +27,14 @@ class ThreadPool {
   void enqueue(Job<>&& job);
   void waitForIdle();
 
+  // Runs one queued job on the calling thread, so a thread that is waiting on
+  // other jobs can help drain the queues instead of blocking a worker
+  bool runPendingJob();
+
+  size_t workerCount() const;
+
  private:
-  void start(std::size_t count);
+  void start(std::size_t count, const std::function<void(size_t)>& onThreadStart);
   void stop();
 
   std::vector<std::thread> _threads;
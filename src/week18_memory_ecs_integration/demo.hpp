@@ -0,0 +1,248 @@
+#pragma once
+
+#include <cmath>
+
+#include "ecs/World.hpp"
+#include "ecs/component/Component.hpp"
+#include "ecs/system/System.hpp"
+#include "ecs/system/SystemScheduler.hpp"
+#include "ecs/system/SystemTraits.hpp"
+#include "tasks/JobSystem.hpp"
+
+//
+//  Frame graph built by the scheduler. Input -> Physics and Physics -> Render/Damage
+//  come from DependsOn, Acceleration is ordered by its Velocity writes and its
+//  Position reads.
+//
+//    InputSystem ──> AccelerationSystem ──> PhysicsSystem ─┬──> RenderSystem
+//                                                          └──> DamageSystem
+//
+
+namespace Tag {
+struct InputUpdate {};
+struct PhysicsUpdate {};
+};  // namespace Tag
+
+struct Position : public Component<Position> {
+  COMPONENT_NAME("Position");
+  Position() = default;
+  Position(float _x, float _y) : x(_x), y(_y) {}
+  float x = 0;
+  float y = 0;
+};
+
+struct Velocity : public Component<Velocity> {
+  COMPONENT_NAME("Velocity");
+  Velocity() = default;
+  Velocity(float _dx, float _dy) : dx(_dx), dy(_dy) {}
+  float dx = 0;
+  float dy = 0;
+};
+
+struct Acceleration : public Component<Acceleration> {
+  COMPONENT_NAME("Acceleration");
+  Acceleration(float _ax, float _ay) : ax(_ax), ay(_ay) {}
+  float ax = 0;
+  float ay = 0;
+};
+
+struct RenderState : public Component<RenderState> {
+  COMPONENT_NAME("RenderState");
+  RenderState(bool v) : visible(v) {}
+  bool visible = true;
+};
+
+struct Health : public Component<Health> {
+  COMPONENT_NAME("Health");
+  Health(float c) : current(c) {}
+  float current = 100.0f;
+};
+
+// A one frame push, registered with ComponentAllocation::Frame
+struct Impulse : public Component<Impulse> {
+  COMPONENT_NAME("Impulse");
+  Impulse(float _x, float _y) : x(_x), y(_y) {}
+  float x = 0;
+  float y = 0;
+};
+
+class InputSystem : public System {
+ public:
+  void update(World& world, float dt) override {
+    for (auto [id, vel] : world.view<Velocity>()) {
+      vel->dx += 0.1f * dt;  // Fake input
+      vel->dy += 0.1f * dt;
+    }
+  }
+  const char* name() const override { return "InputSystem"; }
+};
+
+template <>
+struct SystemTraits<InputSystem> {
+  using Reads = TypeList<>;
+  using Writes = TypeList<Velocity>;
+  using DependsOn = TypeList<>;
+  using Provides = TypeList<Tag::InputUpdate>;
+};
+
+class AccelerationSystem : public System {
+ public:
+  void attach(World& world) override {
+    // Nested inside the <Position, Velocity> group used by PhysicsSystem
+    _group = &world.group<const Position, Velocity, const Acceleration>();
+  }
+
+  void update(World&, float dt) override {
+    _group->each([dt](EntityId, const Position&, Velocity& vel, const Acceleration& acc) {
+      vel.dx += acc.ax * dt;
+      vel.dy += acc.ay * dt;
+    });
+  }
+  const char* name() const override { return "AccelerationSystem"; }
+
+ private:
+  Group<const Position, Velocity, const Acceleration>* _group = nullptr;
+};
+
+template <>
+struct SystemTraits<AccelerationSystem> {
+  using Reads = TypeList<Position, Acceleration>;
+  using Writes = TypeList<Velocity>;
+  using DependsOn = TypeList<Tag::InputUpdate>;
+  using Provides = TypeList<>;
+};
+
+// Fanned out over the group by the scheduler
+class PhysicsSystem : public System {
+ public:
+  void attach(World& world) override { _group = &world.group<Position, const Velocity>(); }
+
+  void update(World& world, float dt) override {
+    updateRange(world, dt, SystemRange{0, costHint(world)});
+  }
+
+  bool supportsRange() const override { return true; }
+  size_t costHint(World&) override { return _group->size(); }
+
+  void updateRange(World&, float dt, SystemRange range) override {
+    _group->eachRange(range.begin, range.end, [dt](EntityId, Position& pos, const Velocity& vel) {
+      pos.x += vel.dx * dt;
+      pos.y += vel.dy * dt;
+    });
+  }
+  const char* name() const override { return "PhysicsSystem"; }
+
+ private:
+  Group<Position, const Velocity>* _group = nullptr;
+};
+
+template <>
+struct SystemTraits<PhysicsSystem> {
+  using Reads = TypeList<Velocity>;
+  using Writes = TypeList<Position>;
+  using DependsOn = TypeList<Tag::InputUpdate>;
+  using Provides = TypeList<Tag::PhysicsUpdate>;
+};
+
+class RenderSystem : public System {
+ public:
+  void update(World& world, float) override {
+    // Only entities that moved this frame can change visibility
+    for (auto [id, pos, rs] : world.view<Changed<Position>, RenderState>()) {
+      rs->visible = (pos->x >= 0 && pos->y >= 0);  // Simple visibility logic
+    }
+  }
+  const char* name() const override { return "RenderSystem"; }
+};
+
+template <>
+struct SystemTraits<RenderSystem> {
+  using Reads = TypeList<Position>;
+  using Writes = TypeList<RenderState>;
+  using DependsOn = TypeList<Tag::PhysicsUpdate>;
+  using Provides = TypeList<>;
+};
+
+class DamageSystem : public System {
+ public:
+  void attach(World& world) override { _query = &world.query<const Position, Health>(); }
+
+  void update(World& world, float dt) override {
+    // Runs alongside other systems, so destruction is deferred to the sync point
+    CommandBuffer& commands = world.commands();
+    _query->forEach([&](EntityId id, const Position& pos, Health& health) {
+      if (pos.x > 5.0f) {
+        health.current -= 1.0f * dt;  // Apply damage if entity moves past a point
+      }
+      if (health.current <= 0.0f) {
+        commands.destroyEntity(id);
+      }
+    });
+  }
+  const char* name() const override { return "DamageSystem"; }
+
+ private:
+  Query<const Position, Health>* _query = nullptr;
+};
+
+template <>
+struct SystemTraits<DamageSystem> {
+  using Reads = TypeList<Position>;
+  using Writes = TypeList<Health>;
+  using DependsOn = TypeList<Tag::PhysicsUpdate>;
+  using Provides = TypeList<>;
+};
+
+// Steps at a fixed 60 Hz, however long the frame was
+class FixedStepSystem : public System {
+ public:
+  void update(World&, float dt) override {
+    ++steps;
+    simulated += dt;
+  }
+  const char* name() const override { return "FixedStepSystem"; }
+
+  int steps = 0;
+  float simulated = 0.0f;
+};
+
+template <>
+struct SystemTraits<FixedStepSystem> {
+  using Reads = TypeList<Position>;
+  using Writes = TypeList<>;
+  using DependsOn = TypeList<>;
+  using Provides = TypeList<>;
+  static constexpr SystemRate Rate = SystemRate::fixed(60.0f);
+};
+
+// Decision making that only has to run ten times a second
+class AiSystem : public System {
+ public:
+  void attach(World& world) override { _query = &world.query<const Position, Velocity>(); }
+
+  void update(World&, float dt) override {
+    _query->forEach([&](EntityId, const Position& pos, Velocity& vel) {
+      // Turn back towards the origin once far enough out
+      if (pos.x > 100.0f) vel.dx = -std::abs(vel.dx);
+      if (pos.y > 100.0f) vel.dy = -std::abs(vel.dy);
+    });
+    ++runs;
+    elapsed += dt;
+  }
+  const char* name() const override { return "AiSystem"; }
+
+  int runs = 0;
+  float elapsed = 0.0f;
+
+ private:
+  Query<const Position, Velocity>* _query = nullptr;
+};
+
+template <>
+struct SystemTraits<AiSystem> {
+  using Reads = TypeList<Position>;
+  using Writes = TypeList<Velocity>;
+  using DependsOn = TypeList<>;
+  using Provides = TypeList<>;
+  static constexpr SystemRate Rate = SystemRate::interval(10.0f);
+};
@@ -0,0 +1,10 @@
+#pragma once
+
+//
+//  Sparse:    one sparse set per component type (ComponentManager)
+//  Archetype: entities grouped by their exact component set into SoA chunks (ArchetypeStorage)
+//
+enum class StorageMode {
+  Sparse,
+  Archetype
+};
@@ -1,40 +1,78 @@
 #pragma once
 
+#include <algorithm>
+#include <cstdint>
+#include <span>
 #include <tuple>
+#include <utility>
+#include <vector>
 
+#include "../tasks/JobSystem.hpp"
+#include "ViewFilters.hpp"
+#include "archetype/Archetype.hpp"
+#include "component/ComponentSignature.hpp"
 #include "component/ComponentStorage.hpp"
 #include "entity/EntityId.hpp"
+#include "entity/EntityManager.hpp"
 
-template <typename... Ts>
+//
+//  A view can be backed by one of two storage engines:
+//
+//    Sparse storage:    walk the packed entities of the smallest participating storage
+//                       (picked at construction) and test each entity's component
+//                       signature against the view's mask
+//    Archetype storage: walk the chunks of every matching archetype, no probing at all
+//
+//  Ts are view arguments (see ViewFilters.hpp). Changed<T>/Added<T> filters are only
+//  available with sparse storage, archetype chunks do not carry change ticks.
+//
+template <ViewArgType... Ts>
 class View {
-  using PrimaryT = std::tuple_element_t<0, std::tuple<Ts...>>;
-  using StorageTuple = std::tuple<ComponentStorage<Ts>&...>;
+  using StorageTuple = std::tuple<ComponentStorage<ComponentOf<Ts>>*...>;
+  using Row = std::tuple<EntityId, typename ViewArg<Ts>::Pointer...>;
+
+  // One chunk of a matching archetype with its column pointers resolved up front
+  struct ChunkSlice {
+    const EntityId* entities;
+    std::tuple<typename ViewArg<Ts>::Pointer...> columns;
+    size_t count;
+  };
 
   class Iterator {
    public:
-    using PrimaryIterator = typename ComponentStorage<PrimaryT>::MapType::iterator;
-
-    Iterator(PrimaryIterator current, PrimaryIterator end, StorageTuple& storages)
-        : _current(current), _end(end), _storages(&storages) {
+    Iterator(const View* view, size_t current)
+        : _view(view), _current(current) {
+      if (!_view->_archetypeMode) {
+        _entities = _view->_driver->entities();
+      }
       advanceToNextValid();
     }
 
     Iterator& operator++() {
-      ++_current;
+      if (_view->_archetypeMode) {
+        ++_row;
+      } else {
+        ++_current;
+      }
       advanceToNextValid();
       return *this;
     }
 
     auto operator->() const = delete;
 
-    std::tuple<EntityId, Ts*...> operator*() const {
-      EntityId id = _current->first;
-      return std::tuple_cat(std::make_tuple(id),
-                            getComponentsFor<Ts...>(id, *_storages, std::index_sequence_for<Ts...>{}));
+    Row operator*() const {
+      if (_view->_archetypeMode) {
+        const ChunkSlice& slice = _view->_slices[_current];
+        return std::tuple_cat(std::make_tuple(slice.entities[_row]),
+                              std::apply([&](auto*... columns) { return std::make_tuple((columns + _row)...); },
+                                         slice.columns));
+      }
+      EntityId id = _entities[_current];
+      return std::apply([&](auto*... storages) { return Row{id, fetch<Ts>(storages, id)...}; }, _view->_storages);
     }
 
     bool operator==(const Iterator& other) const {
-      return _current == other._current;
+      return _current == other._current && _row == other._row;
     }
 
     bool operator!=(const Iterator& other) const {
@@ -42,37 +80,56 @@ class View {
     }
 
    private:
-    PrimaryIterator _current;
-    PrimaryIterator _end;
-    StorageTuple* _storages;
+    const View* _view;
+    std::span<const EntityId> _entities;
+    size_t _current;
+    size_t _row = 0;
 
     void advanceToNextValid() {
-      while (_current != _end) {
-        EntityId id = _current->first;
-        bool allPresent = std::apply(
-            [&](auto&... storages) {
-              // Usage of the C++17 fold expression. This is a binary left fold
-              // e.g. storages = (x, y, z), this: (... && storages.has(id))
-              // is converted to this: x.has(id) && y.has(id) && z.has(id)
-              return (... && storages.has(id));
-            },
-            *_storages);
-        if (allPresent) break;
-        ++_current;
+      if (_view->_archetypeMode) {
+        // Chunks only ever hold matching rows, so this only has to step over chunk ends
+        while (_current < _view->_slices.size() && _row >= _view->_slices[_current].count) {
+          ++_current;
+          _row = 0;
+        }
+        return;
       }
-    }
 
-    template <typename... Us, std::size_t... Is>
-    static std::tuple<Us*...> getComponentsFor(
-        EntityId id,
-        const std::tuple<ComponentStorage<Us>&...>& storages,
-        std::index_sequence<Is...>) {
-      return std::make_tuple(std::get<Is>(storages).get(id)...);
+      // The driving storage is walked by dense index, so this is a linear scan over
+      // its packed EntityId array with an O(1) sparse lookup into the other storages
+      while (_current < _entities.size()) {
+        if (_view->accepts(_entities[_current])) break;
+        ++_current;
+      }
     }
   };
 
  public:
-  View(ComponentStorage<Ts>&... storages) : _storages(storages...) {}
+  View(const EntityManager& entities, ComponentStorage<ComponentOf<Ts>>&... storages)
+      : _entityManager(&entities), _storages(&storages...) {
+    (_mask.set(ComponentOf<Ts>::typeId()), ...);
+
+    // Every result has to be in every storage, so the smallest one bounds the work
+    auto consider = [this](const IComponentStorage& storage) {
+      if (!_driver || storage.size() < _driver->size()) {
+        _driver = &storage;
+      }
+    };
+    (consider(storages), ...);
+    _since = _driver->tick();
+  }
+
+  View(const std::vector<Archetype*>& archetypes) : _archetypeMode(true) {
+    for (Archetype* archetype : archetypes) {
+      for (size_t chunk = 0; chunk < archetype->chunkCount(); ++chunk) {
+        _slices.push_back(ChunkSlice{
+            archetype->entities(chunk),
+            std::tuple<typename ViewArg<Ts>::Pointer...>{static_cast<typename ViewArg<Ts>::Pointer>(
+                archetype->column(chunk, archetype->columnOf(ComponentOf<Ts>::typeId())))...},
+            archetype->chunkSize(chunk)});
+      }
+    }
+  }
 
   ~View() = default;
   View(const View&) = delete;
@@ -80,19 +137,134 @@ class View {
   View(View&&) = default;
   View& operator=(View&&) = default;
 
-  Iterator begin() {
-    auto& primary = std::get<0>(_storages);
-    return Iterator{primary.begin(), primary.end(), _storages};
+  // Widens the Changed/Added filters to everything touched at or after tick,
+  // e.g. the world tick a system last ran at
+  View& since(uint32_t tick) & {
+    _since = tick;
+    return *this;
+  }
+
+  View since(uint32_t tick) && {
+    _since = tick;
+    return std::move(*this);
+  }
+
+  Iterator begin() const {
+    return Iterator{this, 0};
   }
 
-  Iterator end() {
-    auto& primary = std::get<0>(_storages);
-    return Iterator{primary.end(), primary.end(), _storages};
+  Iterator end() const {
+    if (_archetypeMode) {
+      return Iterator{this, _slices.size()};
+    }
+    return Iterator{this, _driver->size()};
   }
 
-  size_t size() const;
-  bool empty() const;
+  // Calls fn(EntityId, Ts&...) for every matching entity, const for read-only arguments
+  template <typename Fn>
+  void forEach(Fn&& fn) const {
+    if (_archetypeMode) {
+      forEachSlice(0, _slices.size(), fn);
+    } else {
+      forEachDriven(0, _driver->size(), fn);
+    }
+  }
+
+  // Same as forEach, but the driving storage (or the chunk list) is split into ranges of
+  // about grainSize entities that run as jobs. Returns once every range has finished.
+  // fn is called concurrently, so it may only touch the components it is handed.
+  template <typename Fn>
+  void parallelForEach(JobSystem& jobs, Fn&& fn, size_t grainSize = 1024) const {
+    if (_archetypeMode) {
+      if (_slices.empty()) return;
+      const size_t rowsPerSlice = std::max<size_t>(1, size() / _slices.size());
+      const size_t slicesPerJob = std::max<size_t>(1, grainSize / rowsPerSlice);
+      jobs.parallelFor(_slices.size(), slicesPerJob, [this, &fn](size_t begin, size_t end) {
+        forEachSlice(begin, end, fn);
+      });
+      return;
+    }
+    jobs.parallelFor(_driver->size(), grainSize, [this, &fn](size_t begin, size_t end) {
+      forEachDriven(begin, end, fn);
+    });
+  }
+
+  // Exact for archetype storage. For sparse storage this is the size of the driving
+  // storage, an upper bound that is exact for single component views.
+  size_t size() const {
+    if (_archetypeMode) {
+      size_t total = 0;
+      for (const ChunkSlice& slice : _slices) total += slice.count;
+      return total;
+    }
+    return _driver->size();
+  }
+
+  bool empty() const {
+    return begin() == end();
+  }
 
  private:
-  StorageTuple _storages;
-};
\ No newline at end of file
+  template <typename Fn>
+  void forEachDriven(size_t begin, size_t end, Fn& fn) const {
+    std::span<const EntityId> entities = _driver->entities();
+    for (size_t i = begin; i < end; ++i) {
+      const EntityId id = entities[i];
+      if (accepts(id)) {
+        std::apply([&](auto*... storages) { fn(id, *fetch<Ts>(storages, id)...); }, _storages);
+      }
+    }
+  }
+
+  // One AND against the mask, only the tick filters still need to look into a storage
+  bool accepts(EntityId id) const {
+    if (!_entityManager->matches(id, _mask)) return false;
+    if constexpr (HasTickFilter<Ts...>) {
+      return std::apply([&](auto*... storages) { return (... && passesFilter<Ts>(storages, id)); }, _storages);
+    }
+    return true;
+  }
+
+  template <typename Arg>
+  bool passesFilter(const ComponentStorage<ComponentOf<Arg>>* storage, EntityId id) const {
+    if constexpr (ViewArg<Arg>::FilterAdded) {
+      return storage->addedTick(storage->indexOf(id)) >= _since;
+    } else if constexpr (ViewArg<Arg>::FilterChanged) {
+      return storage->changedTick(storage->indexOf(id)) >= _since;
+    } else {
+      return true;
+    }
+  }
+
+  // Mutable arguments go through the non-const get so the changed tick is stamped
+  template <typename Arg>
+  static typename ViewArg<Arg>::Pointer fetch(ComponentStorage<ComponentOf<Arg>>* storage, EntityId id) {
+    if constexpr (ViewArg<Arg>::Mutable) {
+      return storage->get(id);
+    } else {
+      return std::as_const(*storage).get(id);
+    }
+  }
+
+  template <typename Fn>
+  void forEachSlice(size_t begin, size_t end, Fn& fn) const {
+    for (size_t s = begin; s < end; ++s) {
+      const ChunkSlice& slice = _slices[s];
+      std::apply(
+          [&](auto*... columns) {
+            for (size_t row = 0; row < slice.count; ++row) {
+              fn(slice.entities[row], columns[row]...);
+            }
+          },
+          slice.columns);
+    }
+  }
+
+  const EntityManager* _entityManager = nullptr;
+  ComponentSignature _mask;
+  StorageTuple _storages{};
+  const IComponentStorage* _driver = nullptr;
+  std::vector<ChunkSlice> _slices;
+  uint32_t _since = 0;
+  bool _archetypeMode = false;
+};
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstdint>
+
+#include "component/ComponentConcepts.hpp"
+
+//
+//  View arguments
+//
+//    T           mutable access, stamps the component's changed tick when handed out
+//    const T     read-only access, leaves the change ticks alone
+//    Changed<T>  only entities whose T was handed out mutably at or after the view's tick
+//    Added<T>    only entities whose T was added at or after the view's tick
+//
+//  Filtered components are yielded read-only so that reading them does not re-mark
+//  them as changed. Views compare against the world's current tick unless widened
+//  with View::since().
+//
+template <ComponentType T>
+struct Changed {};
+
+template <ComponentType T>
+struct Added {};
+
+template <typename T>
+struct ViewArg {
+  using Component = T;
+  using Pointer = T*;
+  static constexpr bool Mutable = true;
+  static constexpr bool FilterAdded = false;
+  static constexpr bool FilterChanged = false;
+};
+
+template <typename T>
+struct ViewArg<const T> : ViewArg<T> {
+  using Pointer = const T*;
+  static constexpr bool Mutable = false;
+};
+
+template <typename T>
+struct ViewArg<Changed<T>> : ViewArg<const T> {
+  static constexpr bool FilterChanged = true;
+};
+
+template <typename T>
+struct ViewArg<Added<T>> : ViewArg<const T> {
+  static constexpr bool FilterAdded = true;
+};
+
+template <typename T>
+using ComponentOf = typename ViewArg<T>::Component;
+
+template <typename T>
+concept ViewArgType = ComponentType<ComponentOf<T>>;
+
+template <typename... Ts>
+inline constexpr bool HasTickFilter = (... || (ViewArg<Ts>::FilterAdded || ViewArg<Ts>::FilterChanged));
@@ -1,11 +1,56 @@
 #include "World.hpp"
 
+#include <array>
+#include <bit>
+#include <cstring>
+
+#include "snapshot/MappedFile.hpp"
+#include "snapshot/Snapshot.hpp"
+
+World::World(StorageMode mode) : _storageMode(mode) {}
+
 EntityRef World::operator[](EntityId id) {
   return EntityRef{id, this};
 }
 
-void World::buildExecutionGraph(TaskGraph& graph, float dt) {
-  _systemScheduler.buildTaskGraph(graph, *this, dt);
+StorageMode World::storageMode() const {
+  return _storageMode;
+}
+
+uint32_t World::currentTick() const {
+  return _tick;
+}
+
+void World::advanceFrame() {
+  flushDestroyedEntities();
+  releaseTransientComponents();
+  ++_tick;
+  _componentManager.setTick(_tick);
+  _componentManager.reportUsage();
+}
+
+void World::reportComponentMemory() {
+  _componentManager.reportUsage();
+}
+
+TaskGraph& World::executionGraph(float dt) {
+  return _systemScheduler.frameGraph(*this, dt);
+}
+
+const TaskGraph& World::systemGraph() {
+  return _systemScheduler.compiledGraph(*this);
+}
+
+void World::setSystemParallelism(size_t chunks) {
+  _systemScheduler.setParallelism(chunks);
+}
+
+CommandBuffer& World::commands() {
+  return _commandQueue->local();
+}
+
+void World::flushCommands() {
+  _commandQueue->flush(*this);
 }
 
 EntityBuilder World::builder() {
@@ -14,10 +59,14 @@ EntityBuilder World::builder() {
 }
 
 EntityId World::createEntity() {
-  return _entityManager.create();
+  EntityId id = _entityManager.create();
+  if (_storageMode == StorageMode::Archetype) {
+    _archetypeStorage.createEntity(id);
+  }
+  return id;
 }
 
-EntityId World::createEntity(std::string_view tag) {
+EntityId World::createEntity(TagKey tag) {
   EntityId id = createEntity();
   addTag(id, tag);
   return id;
@@ -28,140 +77,635 @@ bool World::isAlive(EntityId id) const {
 }
 
 void World::destroyEntity(EntityId id) {
-  if (!isAlive(id)) return;
+  if (!retireEntity(id)) return;
+
+  if (_storageMode == StorageMode::Sparse) {
+    const ComponentSignature& signature = _entityManager.signature(id);
+    for (ComponentId component = 0; component < MaxComponents; ++component) {
+      if (signature.test(component)) {
+        _componentManager.rawStorage(component)->remove(id);
+      }
+    }
+  }
+  _entityManager.release(id.index);
+}
+
+void World::destroyEntityDeferred(EntityId id) {
+  if (!retireEntity(id)) return;
+  _pendingDestroy.push_back(id);
+}
+
+void World::flushDestroyedEntities() {
+  if (_pendingDestroy.empty()) return;
+
+  if (_storageMode == StorageMode::Sparse) {
+    ComponentSignature touched;
+    for (EntityId id : _pendingDestroy) {
+      touched |= _entityManager.signature(id);
+    }
+    for (ComponentId component = 0; component < MaxComponents; ++component) {
+      if (touched.test(component)) {
+        _componentManager.rawStorage(component)->removeBatch(_pendingDestroy);
+      }
+    }
+  }
+
+  for (EntityId id : _pendingDestroy) {
+    _entityManager.release(id.index);
+  }
+  _pendingDestroy.clear();
+}
+
+bool World::retireEntity(EntityId id) {
+  if (!isAlive(id)) return false;
+
+  if (hasComponent<Hierarchy>(id)) {
+    detachHierarchy(id);
+  }
+  _tags.clear(id.index);
 
-  auto it = _entityToTags.find(id);
-  if (it != _entityToTags.end()) {
-    for (TagSymbol tag : it->second) {
-      _tagToEntities[tag].erase(id);
+  if (_storageMode == StorageMode::Archetype) {
+    // Archetype rows are cheap to drop and views have no liveness check, so they go now
+    _archetypeStorage.destroyEntity(id);
+  } else if (tracksMembership()) {
+    // Leave the groups right away so group iteration never sees the dead entity
+    const ComponentSignature& signature = _entityManager.signature(id);
+    for (ComponentId component = 0; component < MaxComponents; ++component) {
+      if (signature.test(component)) {
+        notifyComponentRemoving(component, id);
+      }
     }
-    _entityToTags.erase(it);
   }
+  return _entityManager.retire(id);
+}
 
-  _entityManager.destroy(id);
+std::pmr::memory_resource* World::allocationResource(ComponentAllocation allocation) {
+  switch (allocation) {
+    case ComponentAllocation::Heap:
+      break;
+    case ComponentAllocation::Pool:
+      if (!_componentPool) {
+        _componentPool = std::make_unique<PoolResource>("ComponentPool");
+      }
+      return _componentPool.get();
+    case ComponentAllocation::Frame:
+      if (!_transientResource) {
+        _transientMemory = std::make_unique<std::byte[]>(TransientArenaSize);
+        _transientArena = std::make_unique<FrameArena>(std::span<std::byte>(_transientMemory.get(), TransientArenaSize));
+        _transientResource = std::make_unique<FrameResource>(*_transientArena);
+      }
+      return _transientResource.get();
+  }
+  return std::pmr::get_default_resource();
+}
+
+void World::releaseTransientComponents() {
+  if (!_transientArena) return;
+
+  for (ComponentId component : _transientComponents) {
+    IComponentStorage* storage = _componentManager.rawStorage(component);
+    // Group notifications reorder the storage, so walk a copy of its entities
+    const std::vector<EntityId> entities(storage->entities().begin(), storage->entities().end());
+    for (EntityId id : entities) {
+      if (!isAlive(id) || !_entityManager.signature(id).test(component)) continue;
+      _entityManager.removeComponent(id, component);
+      notifyComponentRemoving(component, id);
+    }
+    storage->release();
+  }
+  _transientArena->reset();
+}
+
+std::vector<EntityId> World::instantiate(const Prefab& prefab, size_t count) {
+  std::vector<EntityId> ids;
+  _entityManager.createBatch(count, ids);
+  for (EntityId id : ids) {
+    _entityManager.setSignature(id, prefab.signature());
+  }
+
+  if (_storageMode == StorageMode::Archetype) {
+    std::array<const Prefab::Entry*, MaxComponents> entries{};
+    for (const Prefab::Entry& entry : prefab._entries) {
+      entry.registerArchetype(_archetypeStorage);
+      entries[entry.component] = &entry;
+    }
+    _archetypeStorage.createEntities(ids, prefab.signature(), [&](void* destination, ComponentId component) {
+      entries[component]->copyConstruct(destination, entries[component]->prototype.get());
+    });
+    return ids;
+  }
+
+  for (const Prefab::Entry& entry : prefab._entries) {
+    entry.emplaceSparse(_componentManager, ids, entry.prototype.get());
+  }
+  if (tracksMembership()) {
+    for (const Prefab::Entry& entry : prefab._entries) {
+      for (EntityId id : ids) {
+        notifyComponentAdded(entry.component, id);
+      }
+    }
+  }
+  return ids;
+}
+
+std::vector<EntityId> World::merge(World& staging) {
+  if (_storageMode != StorageMode::Sparse || staging._storageMode != StorageMode::Sparse) {
+    throw std::runtime_error("Merging worlds is only available with sparse storage");
+  }
+  staging.flushDestroyedEntities();
+
+  const uint32_t capacity = staging._entityManager.capacity();
+  size_t live = 0;
+  for (uint32_t index = 0; index < capacity; ++index) {
+    live += staging.isAlive(EntityId{index, staging._entityManager.generation(index)});
+  }
+  std::vector<EntityId> ids;
+  _entityManager.createBatch(live, ids);
+
+  std::vector<EntityId> remap(capacity);
+  size_t next = 0;
+  for (uint32_t index = 0; index < capacity; ++index) {
+    const EntityId source{index, staging._entityManager.generation(index)};
+    if (!staging.isAlive(source)) continue;
+    remap[index] = ids[next++];
+    _entityManager.setSignature(remap[index], staging._entityManager.signature(source));
+  }
+
+  _componentManager.mergeFrom(staging._componentManager, remap);
+
+  // Hierarchy links still name staging entities
+  const auto remapLink = [&](EntityId& link) {
+    if (link != NullEntity) link = remap[link.index];
+  };
+  for (EntityId id : ids) {
+    if (Hierarchy* node = getComponent<Hierarchy>(id)) {
+      remapLink(node->parent);
+      remapLink(node->firstChild);
+      remapLink(node->nextSibling);
+    }
+  }
+
+  for (TagId tag = 0; tag < staging._tags.tagCount(); ++tag) {
+    const std::span<const uint64_t> bits = staging._tags.bits(tag);
+    for (size_t word = 0; word < bits.size(); ++word) {
+      for (uint64_t rest = bits[word]; rest; rest &= rest - 1) {
+        _tags.add(tag, remap[word * 64 + std::countr_zero(rest)].index);
+      }
+    }
+  }
+
+  if (tracksMembership()) {
+    for (EntityId id : ids) {
+      const ComponentSignature& signature = _entityManager.signature(id);
+      for (ComponentId component = 0; component < MaxComponents; ++component) {
+        if (signature.test(component)) {
+          notifyComponentAdded(component, id);
+        }
+      }
+    }
+  }
+
+  // The storages were emptied by the move
+  staging._entityManager = EntityManager{};
+  staging._tags.reset();
+  staging.rebuildMembership();
+  return ids;
 }
 
 EntityId World::cloneEntity(EntityId src) {
   if (!isAlive(src)) return EntityId{};
   EntityId dst = createEntity();
 
-  const auto& tags = getTags(src);
-  for (TagSymbol tag : tags) {
-    _tagToEntities[tag].insert(dst);
-    _entityToTags[dst].insert(tag);
+  _tags.copy(src.index, dst.index);
+
+  const ComponentSignature signature = _entityManager.signature(src);
+  if (_storageMode == StorageMode::Archetype) {
+    _archetypeStorage.cloneEntity(src, dst);
+    _entityManager.setSignature(dst, signature);
+    return dst;
   }
 
-  _registry.forEachRegisteredComponent([&](ComponentId id) {
-    auto* base = _componentManager.rawStorage(id);
-    if (!base) return;
+  for (ComponentId id = 0; id < MaxComponents; ++id) {
+    if (!signature.test(id)) continue;
+    _componentManager.rawStorage(id)->cloneComponent(src, dst);
+    _entityManager.addComponent(dst, id);
+    notifyComponentAdded(id, dst);
+  }
 
-    if (base->has(src)) {
-      base->cloneComponent(src, dst);
+  // The copied links are the source's, the clone becomes a childless sibling of it
+  if (Hierarchy* node = getComponent<Hierarchy>(dst)) {
+    const EntityId parent = node->parent;
+    *node = Hierarchy{};
+    if (parent != NullEntity) {
+      setParent(dst, parent);
     }
-  });
+  }
   return dst;
 }
 
-void World::addTag(EntityId id, std::string_view tag) {
-  if (!isAlive(id)) return;
+void World::setParent(EntityId child, EntityId parent) {
+  if (!isAlive(child) || !isAlive(parent)) {
+    throw std::runtime_error("setParent needs two live entities");
+  }
+  for (EntityId ancestor = parent; ancestor != NullEntity;) {
+    if (ancestor == child) {
+      throw std::runtime_error("setParent would create a cycle");
+    }
+    const Hierarchy* node = getComponent<Hierarchy>(ancestor);
+    ancestor = node ? node->parent : NullEntity;
+  }
 
-  TagSymbol symbol = toTagSymbol(tag);
-  _tagToEntities[symbol].insert(id);
-  _entityToTags[id].insert(symbol);
+  if (!hasComponent<Hierarchy>(child)) addComponent<Hierarchy>(child);
+  if (!hasComponent<Hierarchy>(parent)) addComponent<Hierarchy>(parent);
+  unlinkFromParent(child);
+
+  // Fetched after the adds, which may have moved rows
+  Hierarchy* node = getComponent<Hierarchy>(child);
+  Hierarchy* parentNode = getComponent<Hierarchy>(parent);
+  node->parent = parent;
+  node->nextSibling = parentNode->firstChild;
+  parentNode->firstChild = child;
+  setSubtreeDepth(child, parentNode->depth + 1);
 }
 
-void World::removeTag(EntityId id, std::string_view tag) {
-  if (!isAlive(id)) return;
-  TagSymbol symbol = toTagSymbol(tag);
-  _tagToEntities[symbol].erase(id);
-  _entityToTags[id].erase(symbol);
+void World::removeParent(EntityId child) {
+  if (!hasComponent<Hierarchy>(child)) return;
+  unlinkFromParent(child);
+  setSubtreeDepth(child, 0);
+}
+
+EntityId World::parentOf(EntityId id) {
+  const Hierarchy* node = getComponent<Hierarchy>(id);
+  return node ? node->parent : NullEntity;
+}
 
-  if (_tagToEntities[symbol].empty()) {
-    _tagToEntities.erase(symbol);
+void World::unlinkFromParent(EntityId child) {
+  Hierarchy* node = getComponent<Hierarchy>(child);
+  if (node->parent == NullEntity) return;
+
+  Hierarchy* parentNode = getComponent<Hierarchy>(node->parent);
+  if (parentNode->firstChild == child) {
+    parentNode->firstChild = node->nextSibling;
+  } else {
+    for (EntityId sibling = parentNode->firstChild; sibling != NullEntity;) {
+      Hierarchy* siblingNode = getComponent<Hierarchy>(sibling);
+      if (siblingNode->nextSibling == child) {
+        siblingNode->nextSibling = node->nextSibling;
+        break;
+      }
+      sibling = siblingNode->nextSibling;
+    }
+  }
+  node->parent = NullEntity;
+  node->nextSibling = NullEntity;
+}
+
+void World::setSubtreeDepth(EntityId root, uint32_t depth) {
+  std::vector<std::pair<EntityId, uint32_t>> pending{{root, depth}};
+  while (!pending.empty()) {
+    const auto [id, level] = pending.back();
+    pending.pop_back();
+    Hierarchy* node = getComponent<Hierarchy>(id);
+    node->depth = level;
+    for (EntityId child = node->firstChild; child != NullEntity; child = getComponent<Hierarchy>(child)->nextSibling) {
+      pending.emplace_back(child, level + 1);
+    }
   }
-  if (_entityToTags[id].empty()) {
-    _entityToTags.erase(id);
+}
+
+void World::detachHierarchy(EntityId id) {
+  unlinkFromParent(id);
+  Hierarchy* node = getComponent<Hierarchy>(id);
+  EntityId child = std::exchange(node->firstChild, NullEntity);
+  while (child != NullEntity) {
+    Hierarchy* childNode = getComponent<Hierarchy>(child);
+    const EntityId next = std::exchange(childNode->nextSibling, NullEntity);
+    childNode->parent = NullEntity;
+    setSubtreeDepth(child, 0);
+    child = next;
   }
 }
 
-void World::clearTags(EntityId id) {
+void World::addTag(EntityId id, TagKey tag) {
+  if (!isAlive(id)) return;
+  addTag(id, TagRegistry::instance().intern(tag));
+}
+
+void World::addTag(EntityId id, TagId tag) {
   if (!isAlive(id)) return;
-  auto it = _entityToTags.find(id);
-  if (it == _entityToTags.end()) return;
+  _tags.add(tag, id.index);
+}
 
-  for (TagSymbol tag : it->second) {
-    _tagToEntities[tag].erase(id);
+void World::removeTag(EntityId id, TagKey tag) {
+  if (!isAlive(id)) return;
+  if (auto tagId = TagRegistry::instance().find(tag)) {
+    removeTag(id, *tagId);
   }
+}
+
+void World::removeTag(EntityId id, TagId tag) {
+  if (!isAlive(id)) return;
+  _tags.remove(tag, id.index);
+}
 
-  _entityToTags.erase(it);
+void World::clearTags(EntityId id) {
+  if (!isAlive(id)) return;
+  _tags.clear(id.index);
 }
 
-bool World::hasTag(EntityId id, std::string_view tag) const {
+bool World::hasTag(EntityId id, TagKey tag) const {
   if (!isAlive(id)) return false;
-  TagSymbol symbol = toTagSymbol(tag);
-  auto it = _entityToTags.find(id);
-  if (it == _entityToTags.end()) return false;
-  return it->second.contains(symbol);
+  auto tagId = TagRegistry::instance().find(tag);
+  return tagId && _tags.has(*tagId, id.index);
 }
 
-void World::retagEntity(EntityId id, std::string_view tag) {
+bool World::hasTag(EntityId id, TagId tag) const {
+  return isAlive(id) && _tags.has(tag, id.index);
+}
+
+void World::retagEntity(EntityId id, TagKey tag) {
   clearTags(id);
   addTag(id, tag);
 }
 
-const std::unordered_set<EntityId> World::findWithTag(std::string_view tag) const {
-  static const std::unordered_set<EntityId> empty;
-  TagSymbol symbol = toTagSymbol(tag);
-  auto it = _tagToEntities.find(symbol);
-  return it != _tagToEntities.end() ? it->second : empty;
+TagIndex::Query World::findWithTag(TagKey tag) const {
+  return findWithTags({tag});
 }
 
-std::unordered_set<EntityId> World::findWithTags(std::initializer_list<std::string_view> tags) const {
-  std::vector<const std::unordered_set<EntityId>*> sets;
-  for (auto tag : tags) {
-    TagSymbol symbol = toTagSymbol(tag);
-    auto it = _tagToEntities.find(symbol);
-    if (it == _tagToEntities.end()) return {};
-    sets.push_back(&it->second);
+TagIndex::Query World::findWithTags(std::initializer_list<TagKey> tags) const {
+  if (tags.size() > TagIndex::MaxQueryTags) {
+    throw std::runtime_error("findWithTags supports at most TagIndex::MaxQueryTags tags");
   }
+  const TagRegistry& registry = TagRegistry::instance();
+  std::array<TagId, TagIndex::MaxQueryTags> ids;
+  size_t count = 0;
+  for (TagKey tag : tags) {
+    auto id = registry.find(tag);
+    if (!id) {
+      // A tag nobody has been given matches nothing
+      return _tags.query({}, _entityManager);
+    }
+    ids[count++] = *id;
+  }
+  return _tags.query({ids.data(), count}, _entityManager);
+}
 
-  if (sets.empty()) return {};
+std::vector<TagKey> World::getTags(EntityId id) const {
+  if (!isAlive(id)) return {};
+  const TagRegistry& registry = TagRegistry::instance();
+  std::vector<TagKey> tags;
+  for (TagId tag : _tags.tagsOf(id.index)) {
+    tags.push_back(registry.tag(tag));
+  }
+  return tags;
+}
 
-  // get the shortest list up front
-  std::sort(sets.begin(), sets.end(), [](const std::unordered_set<EntityId>* a, const std::unordered_set<EntityId>* b) {
-    return a->size() < b->size();
-  });
+void World::validate() const {
+  if (_storageMode != StorageMode::Sparse) return;
 
-  // build the intersection of all of the tags' entities
-  std::unordered_set<EntityId> result = *sets[0];
-  for (size_t i = 1; i < sets.size(); ++i) {
-    std::unordered_set<EntityId> temp;
-    for (EntityId id : *sets[i]) {
-      if (result.contains(id)) {
-        temp.insert(id);
+  // Every stored component has to belong to a live entity whose signature has it
+  for (ComponentId component = 0; component < MaxComponents; ++component) {
+    const IComponentStorage* storage = _componentManager.rawStorage(component);
+    if (!storage) continue;
+    for (EntityId id : storage->entities()) {
+      if (!isAlive(id)) {
+        if (std::find(_pendingDestroy.begin(), _pendingDestroy.end(), id) != _pendingDestroy.end()) continue;
+        throw std::runtime_error("Component storage holds a dead entity.");
+      }
+      if (!_entityManager.signature(id).test(component)) {
+        throw std::runtime_error("Entity signature is missing a stored component.");
       }
     }
-    result = std::move(temp);
-    if (result.empty()) break;
   }
-
-  return result;
 }
 
-const std::unordered_set<TagSymbol>& World::getTags(EntityId id) const {
-  static const std::unordered_set<TagSymbol> empty;
-  auto it = _entityToTags.find(id);
-  return it != _entityToTags.end() ? it->second : empty;
+void World::saveSnapshot(const std::string& path) {
+  if (_storageMode != StorageMode::Sparse) {
+    throw std::runtime_error("Snapshots are only available with sparse storage");
+  }
+  flushDestroyedEntities();
+
+  // Loading replaces every storage, so components that cannot be written would be lost
+  ComponentSignature registered;
+  _registry.forEachRegisteredComponent([&](ComponentId id) { registered.set(id); });
+  std::vector<ComponentId> components;
+  for (ComponentId id = 0; id < MaxComponents; ++id) {
+    const IComponentStorage* storage = _componentManager.rawStorage(id);
+    if (!storage) continue;
+    if (storage->size() > 0 && (!registered.test(id) || !storage->triviallyCopyable())) {
+      throw std::runtime_error("Snapshots need registered, trivially copyable components, " +
+                               std::string(storage->componentName()) + " is not");
+    }
+    if (registered.test(id) && storage->triviallyCopyable()) {
+      components.push_back(id);
+    }
+  }
+  std::vector<TagId> tags;
+  for (TagId tag = 0; tag < _tags.tagCount(); ++tag) {
+    if (!_tags.bits(tag).empty()) {
+      tags.push_back(tag);
+    }
+  }
+
+  const std::span<const uint32_t> generations = _entityManager.generations();
+  const std::span<const uint32_t> freeIndices = _entityManager.freeIndices();
+
+  SnapshotHeader header;
+  header.tick = _tick;
+  header.entityCount = static_cast<uint32_t>(generations.size());
+  header.freeCount = static_cast<uint32_t>(freeIndices.size());
+  header.sectionCount = static_cast<uint32_t>(components.size() + tags.size());
+
+  SnapshotWriter out(path);
+  out.write(&header, sizeof(header));
+  out.write(generations);
+  out.write(freeIndices);
+
+  for (ComponentId id : components) {
+    const ComponentInfo* info = _registry.getInfo(id);
+    const IComponentStorage* storage = _componentManager.rawStorage(id);
+
+    SnapshotSection section;
+    section.kind = SnapshotSectionKind::Component;
+    section.nameLength = static_cast<uint32_t>(info->name.size());
+    section.size = static_cast<uint32_t>(info->size);
+    section.alignment = static_cast<uint32_t>(info->alignment);
+    section.count = storage->size();
+    out.write(&section, sizeof(section));
+    out.write(info->name.data(), info->name.size());
+    out.write(storage->entities());
+    out.write(storage->rawData(), storage->size() * info->size);
+  }
+
+  const TagRegistry& tagRegistry = TagRegistry::instance();
+  for (TagId tag : tags) {
+    const std::string_view name = tagRegistry.tag(tag).name;
+    const std::span<const uint64_t> bits = _tags.bits(tag);
+
+    SnapshotSection section;
+    section.kind = SnapshotSectionKind::Tag;
+    section.nameLength = static_cast<uint32_t>(name.size());
+    section.size = sizeof(uint64_t);
+    section.alignment = alignof(uint64_t);
+    section.count = bits.size();
+    out.write(&section, sizeof(section));
+    out.write(name.data(), name.size());
+    out.write(bits);
+  }
+  out.finish();
 }
 
-void World::validate() const {
-  for (const auto& [id, tags] : _entityToTags) {
-    if (!isAlive(id)) {
-      throw std::runtime_error("Entity has tags but is not alive.");
+void World::loadSnapshot(const std::string& path) {
+  if (_storageMode != StorageMode::Sparse) {
+    throw std::runtime_error("Snapshots are only available with sparse storage");
+  }
+
+  MappedFile file(path);
+  SnapshotReader in(file.bytes());
+
+  SnapshotHeader header;
+  std::memcpy(&header, in.read(sizeof(header)), sizeof(header));
+  if (header.magic != SnapshotMagic) {
+    throw std::runtime_error(path + " is not a world snapshot");
+  }
+  if (header.version != SnapshotVersion) {
+    throw std::runtime_error("Unsupported snapshot version " + std::to_string(header.version));
+  }
+
+  const std::span<const uint32_t> generations = in.read<uint32_t>(header.entityCount);
+  const std::span<const uint32_t> freeIndices = in.read<uint32_t>(header.freeCount);
+  std::vector<bool> free(header.entityCount);
+  for (uint32_t index : freeIndices) {
+    if (index >= header.entityCount) {
+      throw std::runtime_error("Snapshot free list is out of range");
+    }
+    free[index] = true;
+  }
+
+  struct Column {
+    ComponentId id;
+    std::span<const EntityId> entities;
+    const void* rows;
+  };
+  struct TagBits {
+    std::string_view name;
+    std::span<const uint64_t> bits;
+  };
+  std::vector<Column> columns;
+  std::vector<TagBits> tags;
+  std::vector<ComponentSignature> signatures(header.entityCount);
+
+  // Validate every section before touching the world
+  for (uint32_t i = 0; i < header.sectionCount; ++i) {
+    SnapshotSection section;
+    std::memcpy(&section, in.read(sizeof(section)), sizeof(section));
+    const auto* nameBytes = reinterpret_cast<const char*>(in.read(section.nameLength));
+    const std::string_view name(nameBytes, section.nameLength);
+
+    if (section.kind == SnapshotSectionKind::Tag) {
+      const std::span<const uint64_t> bits = in.read<uint64_t>(section.count);
+      // Only live entities may carry tags, tag queries trust the bits
+      for (size_t word = 0; word < bits.size(); ++word) {
+        for (uint64_t rest = bits[word]; rest; rest &= rest - 1) {
+          const size_t index = word * 64 + std::countr_zero(rest);
+          if (index >= header.entityCount || free[index]) {
+            throw std::runtime_error("Snapshot tag " + std::string(name) + " has an invalid entity");
+          }
+        }
+      }
+      // Hash collisions throw here, new names are only interned once the file is accepted
+      TagRegistry::instance().find(name);
+      tags.push_back(TagBits{name, bits});
+      continue;
+    }
+    if (section.kind != SnapshotSectionKind::Component) {
+      throw std::runtime_error("Snapshot has an unknown section");
+    }
+
+    auto id = _registry.getComponentIdByName(name);
+    if (!id) {
+      throw std::runtime_error("Snapshot component " + std::string(name) + " is not registered");
+    }
+    const ComponentInfo* info = _registry.getInfo(*id);
+    if (!info->triviallyCopyable || info->size != section.size || info->alignment != section.alignment) {
+      throw std::runtime_error("Snapshot component " + std::string(name) + " does not match its registration");
+    }
+
+    const std::span<const EntityId> entities = in.read<EntityId>(section.count);
+    const void* rows = in.read(section.count * section.size);
+    for (EntityId entity : entities) {
+      if (entity.index >= header.entityCount || free[entity.index] || generations[entity.index] != entity.generation ||
+          signatures[entity.index].test(*id)) {
+        throw std::runtime_error("Snapshot component " + std::string(name) + " has an invalid entity");
+      }
+      signatures[entity.index].set(*id);
+    }
+    columns.push_back(Column{*id, entities, rows});
+  }
+
+  _pendingDestroy.clear();
+  _componentManager.clearAll();
+  _tags.reset();
+  _entityManager.restore(generations, freeIndices);
+  _tick = header.tick;
+  _componentManager.setTick(_tick);
+
+  for (uint32_t index = 0; index < header.entityCount; ++index) {
+    if (signatures[index].any()) {
+      _entityManager.setSignature(EntityId{index, generations[index]}, signatures[index]);
     }
   }
+  for (const Column& column : columns) {
+    _componentManager.rawStorage(column.id)->assignRaw(column.entities, column.rows);
+  }
+
+  for (const TagBits& tag : tags) {
+    _tags.assign(TagRegistry::instance().intern(tag.name), tag.bits);
+  }
+
+  rebuildMembership();
 }
 
 const ComponentRegistry& World::getRegistry() const {
   return _registry;
-}
\ No newline at end of file
+}
+
+bool World::tracksMembership() const {
+  return !_groups.empty() || !_queries.empty();
+}
+
+void World::rebuildMembership() {
+  // Rebuilding in order keeps every nested group inside the prefix of its parent
+  for (auto& group : _groups) {
+    group->rebuild();
+  }
+  for (auto& query : _queries) {
+    query->rebuild();
+  }
+}
+
+void World::notifyComponentAdded(ComponentId component, EntityId id) {
+  for (auto& group : _groups) {
+    if (group->owned().test(component)) {
+      group->onAdded(id);
+    }
+  }
+  for (auto& query : _queries) {
+    if (query->mask().test(component)) {
+      query->onAdded(id);
+    }
+  }
+}
+
+void World::notifyComponentRemoving(ComponentId component, EntityId id) {
+  for (auto it = _groups.rbegin(); it != _groups.rend(); ++it) {
+    if ((*it)->owned().test(component)) {
+      (*it)->onRemoving(id);
+    }
+  }
+  for (auto& query : _queries) {
+    if (query->mask().test(component)) {
+      query->onRemoving(id);
+    }
+  }
+}
@@ -1,64 +1,157 @@
 #pragma once
 
 #include <algorithm>
+#include <concepts>
 #include <functional>
 #include <initializer_list>
+#include <memory>
+#include <memory_resource>
+#include <stdexcept>
+#include <string>
 #include <string_view>
-#include <unordered_map>
-#include <unordered_set>
+#include <tuple>
+#include <type_traits>
 #include <utility>
 #include <vector>
 
+#include "../memory/FrameArena.hpp"
+#include "../memory/MemoryResources.hpp"
 #include "../tasks/TaskGraph.hpp"
+#include "StorageMode.hpp"
 #include "View.hpp"
+#include "archetype/ArchetypeStorage.hpp"
+#include "command/CommandBuffer.hpp"
+#include "component/ComponentAllocation.hpp"
 #include "component/ComponentConcepts.hpp"
 #include "component/ComponentManager.hpp"
 #include "component/ComponentRegistry.hpp"
+#include "component/ComponentSignature.hpp"
 #include "component/ComponentStorage.hpp"
 #include "entity/EntityBuilder.hpp"
 #include "entity/EntityId.hpp"
 #include "entity/EntityManager.hpp"
 #include "entity/EntityRef.hpp"
+#include "entity/Prefab.hpp"
+#include "entity/TagIndex.hpp"
+#include "entity/TagRegistry.hpp"
 #include "entity/TagSymbol.hpp"
+#include "group/Group.hpp"
+#include "hierarchy/Hierarchy.hpp"
+#include "query/Query.hpp"
+#include "spatial/SpatialHash.hpp"
 #include "system/SystemScheduler.hpp"
 
 class World {
  public:
-  World() = default;
+  // Arena behind ComponentAllocation::Frame, storages continue on the heap once it is full
+  static constexpr size_t TransientArenaSize = 1024 * 1024;
+
+  explicit World(StorageMode mode = StorageMode::Sparse);
   ~World() = default;
+  // Queries, groups and the compiled system graph keep pointers into the world, so
+  // it can be neither copied nor moved
   World(const World&) = delete;
   World& operator=(const World&) = delete;
-  World(World&&) noexcept = default;
-  World& operator=(World&&) noexcept = default;
+  World(World&&) = delete;
+  World& operator=(World&&) = delete;
 
   EntityRef operator[](EntityId id);
 
-  void buildExecutionGraph(TaskGraph& graph, float dt);
-
-  template <ComponentType... Ts>
+  StorageMode storageMode() const;
+
+  // The compiled system graph re-armed for this frame, run it with JobSystem::execute.
+  // Advances the system rate clocks, so call it once per frame
+  TaskGraph& executionGraph(float dt);
+  // The compiled system graph without advancing any clocks, for inspection
+  const TaskGraph& systemGraph();
+  // Most tasks a system supporting ranges is split into, usually the worker count
+  void setSystemParallelism(size_t chunks);
+
+  // Frame counter stamped into component change ticks, Changed<T>/Added<T> views
+  // match components touched at the current tick unless widened with View::since()
+  // Advancing also drops every component registered with ComponentAllocation::Frame.
+  uint32_t currentTick() const;
+  void advanceFrame();
+  // Publishes the bytes of every component storage to the AllocatorTagRegistry,
+  // advanceFrame does so once a frame
+  void reportComponentMemory();
+
+  template <ViewArgType... Ts>
   View<Ts...> view();
 
+  // Returns the owning group for Ts, creating and sorting it on first use. Groups
+  // reorder their storages, so declare them before systems start running in parallel.
+  // const T is read-only, groups over the same components in another order or
+  // constness share one membership. Only available with StorageMode::Sparse.
+  template <ViewArgType... Ts>
+    requires(!HasTickFilter<Ts...>)
+  Group<Ts...>& group();
+
+  // Returns the persistent query for Ts, creating it on first use. Its cached matches
+  // are kept up to date as components come and go. Create queries before systems run
+  // in parallel, like groups.
+  template <ViewArgType... Ts>
+    requires(!HasTickFilter<Ts...>)
+  Query<Ts...>& query();
+
+  // Returns the spatial hash over T's x/y, creating it with cellSize on first use.
+  // Throws if it already exists with another cell size. Entities gaining or losing T
+  // are tracked like query members, call SpatialHash::update at a sync point to pick
+  // up movement. Sparse storage only.
+  template <PlanarPosition T>
+  SpatialHash<T>& spatialHash(float cellSize);
+
   // ENTITY API
   EntityBuilder builder();
   EntityId createEntity();
-  EntityId createEntity(std::string_view tag);
+  EntityId createEntity(TagKey tag);
   bool isAlive(EntityId id) const;
+  // Removes the entity's components from every storage right away
   void destroyEntity(EntityId id);
+  // Kills the entity now but leaves its components and index to flushDestroyedEntities,
+  // which cleans up each storage in one batch (called by advanceFrame)
+  void destroyEntityDeferred(EntityId id);
+  void flushDestroyedEntities();
   EntityId cloneEntity(EntityId src);
 
+  // BATCH SPAWN API
+  // Creates count entities from the prefab, each component type is written for the
+  // whole batch in one pass
+  std::vector<EntityId> instantiate(const Prefab& prefab, size_t count);
+
+  // Creates count entities with default constructed Ts, then calls
+  // init(index, EntityId, Ts&...) once per entity to fill them in
+  template <ComponentType... Ts, typename Fn>
+    requires(std::default_initializable<Ts> && ...)
+  std::vector<EntityId> spawnBatch(size_t count, Fn&& init);
+
+  // Moves every live entity of staging, with its components and tags, into this world.
+  // Each component type is moved in one pass. Returns the new ids in staging index
+  // order and leaves staging empty. Sparse storage only.
+  std::vector<EntityId> merge(World& staging);
+
   // ENTITY TAGS API
-  void addTag(EntityId id, std::string_view tag);
-  void removeTag(EntityId id, std::string_view tag);
+  // Tags are interned in the TagRegistry, prefer "name"_tag literals. Every TagKey
+  // call goes through the registry, hot loops should intern once and pass the TagId.
+  void addTag(EntityId id, TagKey tag);
+  void addTag(EntityId id, TagId tag);
+  void removeTag(EntityId id, TagKey tag);
+  void removeTag(EntityId id, TagId tag);
   void clearTags(EntityId id);
-  bool hasTag(EntityId id, std::string_view tag) const;
-  void retagEntity(EntityId id, std::string_view tag);
-  const std::unordered_set<EntityId> findWithTag(std::string_view tag) const;
-  std::unordered_set<EntityId> findWithTags(std::initializer_list<std::string_view> tags) const;
-  const std::unordered_set<TagSymbol>& getTags(EntityId id) const;
+  bool hasTag(EntityId id, TagKey tag) const;
+  bool hasTag(EntityId id, TagId tag) const;
+  void retagEntity(EntityId id, TagKey tag);
+  // Non-allocating ranges of EntityId, invalidated by any tag change
+  TagIndex::Query findWithTag(TagKey tag) const;
+  TagIndex::Query findWithTags(std::initializer_list<TagKey> tags) const;
+  std::vector<TagKey> getTags(EntityId id) const;
 
   // COMPONENT API
+  // The allocation has to be picked before the storage of T is first used, storages
+  // report their bytes under "Component/<name>" in the AllocatorTagRegistry
   template <ComponentType T>
-  void registerComponent(std::function<void(World&, EntityId, const nlohmann::json&)> deserializer);
+  void registerComponent(std::function<void(World&, EntityId, const nlohmann::json&)> deserializer,
+                         ComponentAllocation allocation = ComponentAllocation::Heap);
 
   template <ComponentType T, typename... Args>
   T& addComponent(EntityId id, Args&&... args);
@@ -74,36 +167,250 @@ class World {
   void removeComponent(EntityId id);
 
   template <typename T, typename... Args>
-  void registerSystem(Args&&... args);
+  T& registerSystem(Args&&... args);
 
   template <ComponentType T>
   void assertComponent(EntityId id);
 
+  // The packed storage of T, registered on first use, for engine systems that walk it
+  // row by row. Sparse storage only.
+  template <ComponentType T>
+  ComponentStorage<T>& storage();
+
+  // HIERARCHY API
+  // Links child as the first child of parent, adding Hierarchy components where
+  // missing. Throws if parent is child itself or one of its descendants.
+  void setParent(EntityId child, EntityId parent);
+  // Turns the entity into a root, its own children stay attached to it
+  void removeParent(EntityId child);
+  // NullEntity for roots and entities outside any hierarchy
+  EntityId parentOf(EntityId id);
+
+  // DEFERRED COMMANDS API
+  // The calling thread's command buffer, fetch it once per job rather than per entity
+  CommandBuffer& commands();
+  // Plays back every recorded command, call at a sync point once no system is running
+  void flushCommands();
+
   const ComponentRegistry& getRegistry() const;
 
+  // SNAPSHOT API
+  // Writes every entity, tag and component to a binary file, one raw column per
+  // component. Throws if a storage with rows holds a component that is not registered
+  // or not trivially copyable, as loading would lose it. Flushes deferred destruction
+  // first. Sparse storage only.
+  void saveSnapshot(const std::string& path);
+  // Replaces the whole world with a snapshot, columns are copied out of a mapping of
+  // the file. Components are matched by name and have to be registered with the same
+  // size. Nothing is changed if the file is rejected.
+  void loadSnapshot(const std::string& path);
+
   // VALIDATION
   void validate() const;
 
  private:
+  friend class RollbackBuffer;
+
+  StorageMode _storageMode = StorageMode::Sparse;
+  uint32_t _tick = 0;
+
+  // Behind pooled and frame transient storages, created on first use. Declared before
+  // the storages so that they outlive them.
+  std::unique_ptr<PoolResource> _componentPool;
+  std::unique_ptr<std::byte[]> _transientMemory;
+  std::unique_ptr<FrameArena> _transientArena;
+  std::unique_ptr<FrameResource> _transientResource;
+  std::vector<ComponentId> _transientComponents;
+
   EntityManager _entityManager;
   ComponentManager _componentManager;
+  ArchetypeStorage _archetypeStorage;
   ComponentRegistry _registry;
   SystemScheduler _systemScheduler;
+  std::unique_ptr<CommandQueue> _commandQueue = std::make_unique<CommandQueue>();
+
+  // Sorted by the number of owned types, so nested groups are visited least
+  // restrictive first when adding and most restrictive first when removing
+  std::vector<std::unique_ptr<IGroup>> _groups;
+  // Groups sharing the membership of one in _groups, never notified
+  std::vector<std::unique_ptr<IGroup>> _sharedGroups;
+  std::vector<std::unique_ptr<IQuery>> _queries;
+
+  TagIndex _tags;
+
+  // Retired by destroyEntityDeferred, waiting for their components and indices to be released
+  std::vector<EntityId> _pendingDestroy;
+
+  // Drops tags, group membership and archetype rows and bumps the generation
+  bool retireEntity(EntityId id);
+
+  std::pmr::memory_resource* allocationResource(ComponentAllocation allocation);
+  // Removes every frame transient component and resets their arena
+  void releaseTransientComponents();
 
-  std::unordered_map<TagSymbol, std::unordered_set<EntityId>> _tagToEntities;
-  std::unordered_map<EntityId, std::unordered_set<TagSymbol>> _entityToTags;
+  // Hierarchy bookkeeping, the entities passed in must have a Hierarchy component
+  void unlinkFromParent(EntityId child);
+  void setSubtreeDepth(EntityId root, uint32_t depth);
+  // Detaches an entity about to die or lose its Hierarchy from its parent and turns
+  // its children into roots
+  void detachHierarchy(EntityId id);
+
+  // Whether groups or queries need the per-entity notifications below
+  bool tracksMembership() const;
+  // Recomputes every group and query after the storages were replaced wholesale
+  void rebuildMembership();
+
+  void notifyComponentAdded(ComponentId component, EntityId id);
+  void notifyComponentRemoving(ComponentId component, EntityId id);
 };
 
 // TEMPLATED METHODS
 
-template <ComponentType... Ts>
+template <ViewArgType... Ts>
 View<Ts...> World::view() {
-  return View<Ts...>(_componentManager.storage<Ts>()...);
+  if (_storageMode == StorageMode::Archetype) {
+    if constexpr (HasTickFilter<Ts...>) {
+      throw std::runtime_error("Changed/Added view filters are only available with sparse storage");
+    }
+    ComponentSignature mask;
+    (mask.set(ComponentOf<Ts>::typeId()), ...);
+
+    std::vector<Archetype*> archetypes;
+    _archetypeStorage.forEachMatching(mask, [&](Archetype& archetype) {
+      archetypes.push_back(&archetype);
+    });
+    return View<Ts...>(archetypes);
+  }
+  return View<Ts...>(_entityManager, _componentManager.storage<ComponentOf<Ts>>()...);
+}
+
+template <ViewArgType... Ts>
+  requires(!HasTickFilter<Ts...>)
+Query<Ts...>& World::query() {
+  for (auto& existing : _queries) {
+    if (auto* match = dynamic_cast<Query<Ts...>*>(existing.get())) {
+      return *match;
+    }
+  }
+
+  std::unique_ptr<Query<Ts...>> created;
+  if (_storageMode == StorageMode::Archetype) {
+    created = std::make_unique<Query<Ts...>>(_archetypeStorage);
+  } else {
+    (_componentManager.registerStorage<ComponentOf<Ts>>(), ...);
+    created = std::make_unique<Query<Ts...>>(_entityManager, _componentManager.storage<ComponentOf<Ts>>()...);
+  }
+  Query<Ts...>& result = *created;
+  _queries.push_back(std::move(created));
+  return result;
+}
+
+template <PlanarPosition T>
+SpatialHash<T>& World::spatialHash(float cellSize) {
+  if (_storageMode != StorageMode::Sparse) {
+    throw std::runtime_error("Spatial hashes are only available with sparse storage");
+  }
+  for (auto& existing : _queries) {
+    if (auto* match = dynamic_cast<SpatialHash<T>*>(existing.get())) {
+      if (match->cellSize() != cellSize) {
+        throw std::runtime_error("A spatial hash over this component already exists with another cell size");
+      }
+      return *match;
+    }
+  }
+
+  _componentManager.registerStorage<T>();
+  auto created = std::make_unique<SpatialHash<T>>(_componentManager.storage<T>(), cellSize);
+  SpatialHash<T>& result = *created;
+  _queries.push_back(std::move(created));
+  return result;
+}
+
+template <ViewArgType... Ts>
+  requires(!HasTickFilter<Ts...>)
+Group<Ts...>& World::group() {
+  if (_storageMode != StorageMode::Sparse) {
+    throw std::runtime_error("Groups are only available with sparse storage");
+  }
+
+  ComponentSignature owned;
+  (owned.set(ComponentOf<Ts>::typeId()), ...);
+
+  for (auto& existing : _groups) {
+    if (existing->owned() == owned) {
+      if (auto* match = dynamic_cast<Group<Ts...>*>(existing.get())) {
+        return *match;
+      }
+      for (auto& shared : _sharedGroups) {
+        if (auto* match = dynamic_cast<Group<Ts...>*>(shared.get())) {
+          return *match;
+        }
+      }
+      auto created = std::make_unique<Group<Ts...>>(*existing, _componentManager.storage<ComponentOf<Ts>>()...);
+      Group<Ts...>& result = *created;
+      _sharedGroups.push_back(std::move(created));
+      return result;
+    }
+    const ComponentSignature shared = existing->owned() & owned;
+    if (shared.any() && shared != owned && shared != existing->owned()) {
+      throw std::runtime_error("Groups may only share owned components when one is nested in the other");
+    }
+  }
+
+  (_componentManager.registerStorage<ComponentOf<Ts>>(), ...);
+  auto created = std::make_unique<Group<Ts...>>(_componentManager.storage<ComponentOf<Ts>>()...);
+  Group<Ts...>& result = *created;
+
+  auto position = std::upper_bound(_groups.begin(), _groups.end(), owned.count(), [](size_t count, const auto& group) {
+    return count < group->owned().count();
+  });
+  _groups.insert(position, std::move(created));
+
+  // Rebuilding in order keeps every nested group inside the prefix of its parent
+  for (auto& existing : _groups) {
+    existing->rebuild();
+  }
+  return result;
+}
+
+template <ComponentType... Ts, typename Fn>
+  requires(std::default_initializable<Ts> && ...)
+std::vector<EntityId> World::spawnBatch(size_t count, Fn&& init) {
+  Prefab prefab;
+  (prefab.with<Ts>(), ...);
+  std::vector<EntityId> ids = instantiate(prefab, count);
+
+  if (_storageMode == StorageMode::Archetype) {
+    for (size_t i = 0; i < ids.size(); ++i) {
+      init(i, ids[i], *_archetypeStorage.get<Ts>(ids[i])...);
+    }
+    return ids;
+  }
+
+  std::tuple<ComponentStorage<Ts>&...> storages{_componentManager.storage<Ts>()...};
+  for (size_t i = 0; i < ids.size(); ++i) {
+    init(i, ids[i], *std::get<ComponentStorage<Ts>&>(storages).get(ids[i])...);
+  }
+  return ids;
 }
 
 template <ComponentType T>
-void World::registerComponent(std::function<void(World&, EntityId, const nlohmann::json&)> deserializer) {
-  this->_componentManager.registerStorage<T>();
+void World::registerComponent(std::function<void(World&, EntityId, const nlohmann::json&)> deserializer,
+                              ComponentAllocation allocation) {
+  if (_storageMode == StorageMode::Archetype) {
+    this->_archetypeStorage.registerComponent<T>();
+  } else {
+    std::pmr::memory_resource* upstream = allocationResource(allocation);
+    const TrackedResource* resource = _componentManager.resource(T::typeId());
+    if (resource && resource->upstream() != upstream) {
+      throw std::runtime_error("Component storage already in use with another allocation");
+    }
+    this->_componentManager.registerStorage<T>(upstream);
+    if (allocation == ComponentAllocation::Frame &&
+        std::find(_transientComponents.begin(), _transientComponents.end(), T::typeId()) == _transientComponents.end()) {
+      _transientComponents.push_back(T::typeId());
+    }
+  }
   this->_registry.registerComponent<T>(T::name(), std::move(deserializer));
 }
 
@@ -115,37 +422,70 @@ T& World::addComponent(EntityId id, Args&&... args) {
   if (hasComponent<T>(id)) {
     throw std::runtime_error("Component already exists for this entity");
   }
-  return _componentManager.emplace<T>(id, std::forward<Args>(args)...);
+  if (_storageMode == StorageMode::Archetype) {
+    T& component = _archetypeStorage.emplace<T>(id, std::forward<Args>(args)...);
+    _entityManager.addComponent(id, T::typeId());
+    return component;
+  }
+  _componentManager.emplace<T>(id, std::forward<Args>(args)...);
+  _entityManager.addComponent(id, T::typeId());
+  notifyComponentAdded(T::typeId(), id);
+  // Groups may have moved the component while sorting
+  return *_componentManager.get<T>(id);
 }
 
 template <ComponentType T>
 [[nodiscard]]
 T* World::getComponent(EntityId id) {
-  if (!isAlive(id)) {
+  if (!hasComponent<T>(id)) {
     return nullptr;
   }
+  if (_storageMode == StorageMode::Archetype) {
+    return _archetypeStorage.get<T>(id);
+  }
   return _componentManager.get<T>(id);
 }
 
+template <ComponentType T>
+ComponentStorage<T>& World::storage() {
+  if (_storageMode != StorageMode::Sparse) {
+    throw std::runtime_error("Storage access is only available with sparse storage");
+  }
+  _componentManager.registerStorage<T>();
+  return _componentManager.storage<T>();
+}
+
 template <ComponentType T>
 bool World::hasComponent(EntityId id) const {
   if (!isAlive(id)) {
     return false;
   }
-  return _componentManager.has<T>(id);
+  return _entityManager.signature(id).test(T::typeId());
 }
 
 template <ComponentType T>
 void World::removeComponent(EntityId id) {
-  if (!isAlive(id)) {
+  if (!hasComponent<T>(id)) {
     return;
   }
+  if constexpr (std::is_same_v<T, Hierarchy>) {
+    // The parent and siblings must not keep linking to an entity outside the hierarchy
+    detachHierarchy(id);
+  }
+  _entityManager.removeComponent(id, T::typeId());
+  if (_storageMode == StorageMode::Archetype) {
+    _archetypeStorage.remove(id, T::typeId());
+    return;
+  }
+  notifyComponentRemoving(T::typeId(), id);
   _componentManager.remove<T>(id);
 }
 
 template <typename T, typename... Args>
-void World::registerSystem(Args&&... args) {
-  _systemScheduler.registerSystem<T>(std::forward<Args>(args)...);
+T& World::registerSystem(Args&&... args) {
+  T& system = _systemScheduler.registerSystem<T>(std::forward<Args>(args)...);
+  system.attach(*this);
+  return system;
 }
 
 template <ComponentType T>
@@ -178,6 +518,23 @@ void EntityRef::remove() {
   world->removeComponent<T>(id);
 }
 
+//
+//  For the CommandBuffer API
+//
+template <ComponentType T>
+void CommandBuffer::applyAdd(World& world, EntityId id, T& value) {
+  if (T* existing = world.getComponent<T>(id)) {
+    *existing = std::move(value);
+    return;
+  }
+  world.addComponent<T>(id, std::move(value));
+}
+
+template <ComponentType T>
+void CommandBuffer::applyRemove(World& world, EntityId id) {
+  world.removeComponent<T>(id);
+}
+
 //
 // For EntityBuilder API
 //
@@ -0,0 +1,115 @@
+#include "Archetype.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <new>
+
+static constexpr size_t ChunkAlignment = 64;
+
+static size_t alignUp(size_t value, size_t alignment) {
+  return (value + alignment - 1) & ~(alignment - 1);
+}
+
+Archetype::Archetype(ComponentSignature signature, const std::vector<ComponentOps>& ops)
+    : _signature(signature), _columnLookup(MaxComponents, npos) {
+  size_t rowBytes = sizeof(EntityId);
+  size_t paddingBytes = 0;
+
+  for (ComponentId id = 0; id < MaxComponents; ++id) {
+    if (!signature.test(id)) continue;
+    assert(id < ops.size() && ops[id] && "Component must be registered before it is used in an archetype");
+    _columnLookup[id] = static_cast<uint32_t>(_componentIds.size());
+    _componentIds.push_back(id);
+    _ops.push_back(ops[id]);
+    rowBytes += ops[id].size;
+    paddingBytes += ops[id].alignment;
+  }
+
+  // Components larger than a chunk still get a single row per chunk
+  _capacity = static_cast<uint32_t>(std::max<size_t>(1, (ChunkBytes - std::min(ChunkBytes, paddingBytes)) / rowBytes));
+
+  size_t offset = sizeof(EntityId) * _capacity;
+  for (const ComponentOps& column : _ops) {
+    offset = alignUp(offset, column.alignment);
+    _offsets.push_back(offset);
+    offset += column.size * _capacity;
+  }
+  _chunkBytes = alignUp(std::max(offset, ChunkBytes), ChunkAlignment);
+}
+
+Archetype::~Archetype() {
+  for (size_t chunk = 0; chunk < _chunks.size(); ++chunk) {
+    for (uint32_t row = 0; row < _chunks[chunk].count; ++row) {
+      for (uint32_t column = 0; column < _ops.size(); ++column) {
+        _ops[column].destroy(at(Row{static_cast<uint32_t>(chunk), row}, column));
+      }
+    }
+    ::operator delete(_chunks[chunk].data, std::align_val_t{ChunkAlignment});
+  }
+}
+
+Archetype::Row Archetype::allocate(EntityId entity) {
+  if (_chunks.empty() || _chunks.back().count == _capacity) {
+    auto* data = static_cast<std::byte*>(::operator new(_chunkBytes, std::align_val_t{ChunkAlignment}));
+    _chunks.push_back(Chunk{data, 0});
+  }
+
+  const uint32_t chunk = static_cast<uint32_t>(_chunks.size() - 1);
+  Row row{chunk, _chunks[chunk].count};
+  entities(chunk)[row.index] = entity;
+  ++_chunks[chunk].count;
+  ++_size;
+  return row;
+}
+
+void Archetype::deallocateLast() {
+  assert(_size > 0);
+  --_chunks.back().count;
+  --_size;
+  if (_chunks.back().count == 0) {
+    releaseLastChunk();
+  }
+}
+
+std::optional<EntityId> Archetype::removeRow(Row row) {
+  for (uint32_t column = 0; column < _ops.size(); ++column) {
+    _ops[column].destroy(at(row, column));
+  }
+
+  const uint32_t lastChunk = static_cast<uint32_t>(_chunks.size() - 1);
+  const Row last{lastChunk, _chunks[lastChunk].count - 1};
+
+  std::optional<EntityId> moved;
+  if (last.chunk != row.chunk || last.index != row.index) {
+    for (uint32_t column = 0; column < _ops.size(); ++column) {
+      void* source = at(last, column);
+      _ops[column].moveConstruct(at(row, column), source);
+      _ops[column].destroy(source);
+    }
+    EntityId entity = entities(last.chunk)[last.index];
+    entities(row.chunk)[row.index] = entity;
+    moved = entity;
+  }
+
+  --_chunks[lastChunk].count;
+  --_size;
+  if (_chunks[lastChunk].count == 0) {
+    releaseLastChunk();
+  }
+  return moved;
+}
+
+uint32_t Archetype::addEdge(ComponentId id) const {
+  auto it = _addEdges.find(id);
+  return it != _addEdges.end() ? it->second : npos;
+}
+
+uint32_t Archetype::removeEdge(ComponentId id) const {
+  auto it = _removeEdges.find(id);
+  return it != _removeEdges.end() ? it->second : npos;
+}
+
+void Archetype::releaseLastChunk() {
+  ::operator delete(_chunks.back().data, std::align_val_t{ChunkAlignment});
+  _chunks.pop_back();
+}
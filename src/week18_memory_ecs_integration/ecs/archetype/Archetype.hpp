@@ -0,0 +1,104 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+#include "../component/ComponentId.hpp"
+#include "../component/ComponentOps.hpp"
+#include "../component/ComponentSignature.hpp"
+#include "../entity/EntityId.hpp"
+
+//
+//  An archetype owns every entity whose component set is exactly its signature.
+//  Rows are packed into fixed-size chunks laid out SoA:
+//
+//      [ EntityId x capacity | column 0 x capacity | column 1 x capacity | ... ]
+//
+//  Rows are always appended to the last chunk and removal moves the very last row
+//  into the hole, so every chunk except the last one is full.
+//
+class Archetype {
+ public:
+  static constexpr size_t ChunkBytes = 16 * 1024;
+  static constexpr uint32_t npos = std::numeric_limits<uint32_t>::max();
+
+  struct Row {
+    uint32_t chunk = 0;
+    uint32_t index = 0;
+  };
+
+  Archetype(ComponentSignature signature, const std::vector<ComponentOps>& ops);
+  ~Archetype();
+
+  Archetype(const Archetype&) = delete;
+  Archetype& operator=(const Archetype&) = delete;
+  Archetype(Archetype&&) = delete;
+  Archetype& operator=(Archetype&&) = delete;
+
+  // Appends a row for the entity, the component columns are left uninitialized
+  Row allocate(EntityId entity);
+
+  // Drops the most recently allocated row without touching its components
+  void deallocateLast();
+
+  // Destroys the components in the row and fills the hole with the last row.
+  // Returns the entity that was moved into the hole, if any.
+  std::optional<EntityId> removeRow(Row row);
+
+  ComponentSignature signature() const { return _signature; }
+  const std::vector<ComponentId>& componentIds() const { return _componentIds; }
+  const ComponentOps& columnOps(uint32_t column) const { return _ops[column]; }
+
+  // Column index of the component inside this archetype or npos
+  uint32_t columnOf(ComponentId id) const {
+    return id < _columnLookup.size() ? _columnLookup[id] : npos;
+  }
+
+  uint32_t capacity() const { return _capacity; }
+  size_t chunkCount() const { return _chunks.size(); }
+  uint32_t chunkSize(size_t chunk) const { return _chunks[chunk].count; }
+  size_t size() const { return _size; }
+
+  EntityId* entities(size_t chunk) {
+    return reinterpret_cast<EntityId*>(_chunks[chunk].data);
+  }
+
+  void* column(size_t chunk, uint32_t column) {
+    return _chunks[chunk].data + _offsets[column];
+  }
+
+  void* at(Row row, uint32_t column) {
+    return _chunks[row.chunk].data + _offsets[column] + row.index * _ops[column].size;
+  }
+
+  // Cached archetype graph edges, npos when the neighbour has not been resolved yet
+  uint32_t addEdge(ComponentId id) const;
+  uint32_t removeEdge(ComponentId id) const;
+  void setAddEdge(ComponentId id, uint32_t archetype) { _addEdges[id] = archetype; }
+  void setRemoveEdge(ComponentId id, uint32_t archetype) { _removeEdges[id] = archetype; }
+
+ private:
+  struct Chunk {
+    std::byte* data = nullptr;
+    uint32_t count = 0;
+  };
+
+  ComponentSignature _signature;
+  std::vector<ComponentId> _componentIds;
+  std::vector<ComponentOps> _ops;
+  std::vector<size_t> _offsets;
+  std::vector<uint32_t> _columnLookup;
+  std::vector<Chunk> _chunks;
+  size_t _chunkBytes = ChunkBytes;
+  uint32_t _capacity = 0;
+  size_t _size = 0;
+
+  std::unordered_map<ComponentId, uint32_t> _addEdges;
+  std::unordered_map<ComponentId, uint32_t> _removeEdges;
+
+  void releaseLastChunk();
+};
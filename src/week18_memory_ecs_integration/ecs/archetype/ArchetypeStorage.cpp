@@ -0,0 +1,131 @@
+#include "ArchetypeStorage.hpp"
+
+#include <stdexcept>
+
+ArchetypeStorage::ArchetypeStorage() {
+  findOrCreateArchetype(ComponentSignature{});
+}
+
+void ArchetypeStorage::createEntity(EntityId id) {
+  if (_locations.size() <= id.index) {
+    _locations.resize(id.index + 1);
+  }
+  Archetype::Row row = _archetypes[0]->allocate(id);
+  _locations[id.index] = Location{0, row};
+}
+
+void ArchetypeStorage::destroyEntity(EntityId id) {
+  if (id.index >= _locations.size()) return;
+  Location location = _locations[id.index];
+  if (location.archetype == Archetype::npos) return;
+
+  releaseRow(location.archetype, location.row);
+  _locations[id.index] = Location{};
+}
+
+void ArchetypeStorage::cloneEntity(EntityId src, EntityId dst) {
+  const Location source = _locations[src.index];
+  Archetype& archetype = *_archetypes[source.archetype];
+
+  for (uint32_t column = 0; column < archetype.componentIds().size(); ++column) {
+    if (!archetype.columnOps(column).copyConstruct) {
+      throw std::runtime_error("Cannot clone an entity with a non-copyable component");
+    }
+  }
+
+  Archetype::Row row = archetype.allocate(dst);
+  for (uint32_t column = 0; column < archetype.componentIds().size(); ++column) {
+    archetype.columnOps(column).copyConstruct(archetype.at(row, column), archetype.at(source.row, column));
+  }
+
+  // dst may itself be the row moved into the hole when both live in the same archetype,
+  // so its new location has to be in place before the old row is released
+  const Location previous = _locations[dst.index];
+  _locations[dst.index] = Location{source.archetype, row};
+  releaseRow(previous.archetype, previous.row);
+}
+
+void ArchetypeStorage::remove(EntityId id, ComponentId component) {
+  if (!has(id, component)) return;
+
+  const uint32_t target = removeTarget(_locations[id.index].archetype, component);
+  Archetype::Row row = _archetypes[target]->allocate(id);
+  migrate(id, target, row);
+}
+
+bool ArchetypeStorage::has(EntityId id, ComponentId component) const {
+  if (id.index >= _locations.size()) return false;
+  const Location& location = _locations[id.index];
+  if (location.archetype == Archetype::npos) return false;
+  return _archetypes[location.archetype]->columnOf(component) != Archetype::npos;
+}
+
+void* ArchetypeStorage::get(EntityId id, ComponentId component) {
+  if (id.index >= _locations.size()) return nullptr;
+  const Location& location = _locations[id.index];
+  if (location.archetype == Archetype::npos) return nullptr;
+
+  Archetype& archetype = *_archetypes[location.archetype];
+  const uint32_t column = archetype.columnOf(component);
+  if (column == Archetype::npos) return nullptr;
+  return archetype.at(location.row, column);
+}
+
+uint32_t ArchetypeStorage::findOrCreateArchetype(ComponentSignature signature) {
+  auto it = _archetypeLookup.find(signature);
+  if (it != _archetypeLookup.end()) {
+    return it->second;
+  }
+
+  const uint32_t index = static_cast<uint32_t>(_archetypes.size());
+  _archetypes.push_back(std::make_unique<Archetype>(signature, _ops));
+  _archetypeLookup.emplace(signature, index);
+  return index;
+}
+
+uint32_t ArchetypeStorage::addTarget(uint32_t archetype, ComponentId component) {
+  uint32_t target = _archetypes[archetype]->addEdge(component);
+  if (target == Archetype::npos) {
+    ComponentSignature signature = _archetypes[archetype]->signature();
+    signature.set(component);
+    target = findOrCreateArchetype(signature);
+    _archetypes[archetype]->setAddEdge(component, target);
+    _archetypes[target]->setRemoveEdge(component, archetype);
+  }
+  return target;
+}
+
+uint32_t ArchetypeStorage::removeTarget(uint32_t archetype, ComponentId component) {
+  uint32_t target = _archetypes[archetype]->removeEdge(component);
+  if (target == Archetype::npos) {
+    ComponentSignature signature = _archetypes[archetype]->signature();
+    signature.reset(component);
+    target = findOrCreateArchetype(signature);
+    _archetypes[archetype]->setRemoveEdge(component, target);
+    _archetypes[target]->setAddEdge(component, archetype);
+  }
+  return target;
+}
+
+void ArchetypeStorage::migrate(EntityId id, uint32_t target, Archetype::Row row) {
+  const Location source = _locations[id.index];
+  Archetype& from = *_archetypes[source.archetype];
+  Archetype& to = *_archetypes[target];
+
+  for (uint32_t column = 0; column < from.componentIds().size(); ++column) {
+    const uint32_t targetColumn = to.columnOf(from.componentIds()[column]);
+    if (targetColumn != Archetype::npos) {
+      from.columnOps(column).moveConstruct(to.at(row, targetColumn), from.at(source.row, column));
+    }
+  }
+
+  releaseRow(source.archetype, source.row);
+  _locations[id.index] = Location{target, row};
+}
+
+void ArchetypeStorage::releaseRow(uint32_t archetype, Archetype::Row row) {
+  std::optional<EntityId> moved = _archetypes[archetype]->removeRow(row);
+  if (moved) {
+    _locations[moved->index].row = row;
+  }
+}
@@ -0,0 +1,150 @@
+#pragma once
+
+#include <cassert>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "../component/ComponentConcepts.hpp"
+#include "../component/ComponentId.hpp"
+#include "../component/ComponentOps.hpp"
+#include "../component/ComponentSignature.hpp"
+#include "../entity/EntityId.hpp"
+#include "Archetype.hpp"
+
+//
+//  Archetype based storage engine for the World.
+//
+//  Every live entity sits in exactly one archetype (new entities start in the empty
+//  archetype at index 0). Adding or removing a component migrates the entity's row to
+//  the neighbouring archetype, the neighbours are cached as edges on each archetype.
+//
+//  Callers are expected to have checked that the entity is alive.
+//
+class ArchetypeStorage {
+ public:
+  ArchetypeStorage();
+  ~ArchetypeStorage() = default;
+
+  ArchetypeStorage(const ArchetypeStorage&) = delete;
+  ArchetypeStorage& operator=(const ArchetypeStorage&) = delete;
+  ArchetypeStorage(ArchetypeStorage&&) noexcept = default;
+  ArchetypeStorage& operator=(ArchetypeStorage&&) noexcept = default;
+
+  template <ComponentType T>
+  void registerComponent();
+
+  void createEntity(EntityId id);
+
+  // Places the entities straight into the archetype for signature, skipping the
+  // migrations. construct(destination, ComponentId) must construct every component
+  // and is expected not to throw.
+  template <typename Fn>
+  void createEntities(std::span<const EntityId> ids, ComponentSignature signature, Fn&& construct);
+
+  void destroyEntity(EntityId id);
+  void cloneEntity(EntityId src, EntityId dst);
+
+  template <ComponentType T, typename... Args>
+  T& emplace(EntityId id, Args&&... args);
+
+  void remove(EntityId id, ComponentId component);
+  bool has(EntityId id, ComponentId component) const;
+  void* get(EntityId id, ComponentId component);
+
+  template <ComponentType T>
+  T* get(EntityId id) {
+    return static_cast<T*>(get(id, T::typeId()));
+  }
+
+  // Calls fn(Archetype&) for every non-empty archetype containing all of the masked components
+  template <typename Fn>
+  void forEachMatching(ComponentSignature mask, Fn&& fn);
+
+  size_t archetypeCount() const { return _archetypes.size(); }
+  // Archetypes are never removed, so indices stay valid
+  Archetype& archetypeAt(size_t index) { return *_archetypes[index]; }
+
+ private:
+  struct Location {
+    uint32_t archetype = Archetype::npos;
+    Archetype::Row row;
+  };
+
+  std::vector<ComponentOps> _ops;
+  std::vector<std::unique_ptr<Archetype>> _archetypes;
+  std::unordered_map<ComponentSignature, uint32_t> _archetypeLookup;
+  std::vector<Location> _locations;
+
+  uint32_t findOrCreateArchetype(ComponentSignature signature);
+  uint32_t addTarget(uint32_t archetype, ComponentId component);
+  uint32_t removeTarget(uint32_t archetype, ComponentId component);
+
+  // Moves the entity's shared components into an already allocated row of the
+  // target archetype and frees its row in the source archetype
+  void migrate(EntityId id, uint32_t target, Archetype::Row row);
+  void releaseRow(uint32_t archetype, Archetype::Row row);
+};
+
+template <ComponentType T>
+void ArchetypeStorage::registerComponent() {
+  const ComponentId id = T::typeId();
+  assert(id < MaxComponents && "Too many component types for ComponentSignature");
+  if (_ops.size() <= id) {
+    _ops.resize(id + 1);
+  }
+  if (!_ops[id]) {
+    _ops[id] = ComponentOps::of<T>();
+  }
+}
+
+template <ComponentType T, typename... Args>
+T& ArchetypeStorage::emplace(EntityId id, Args&&... args) {
+  registerComponent<T>();
+  const ComponentId component = T::typeId();
+  assert(!has(id, component) && "Component already exists for this entity");
+
+  const uint32_t target = addTarget(_locations[id.index].archetype, component);
+  Archetype& archetype = *_archetypes[target];
+  Archetype::Row row = archetype.allocate(id);
+
+  T* result = static_cast<T*>(archetype.at(row, archetype.columnOf(component)));
+  try {
+    std::construct_at(result, std::forward<Args>(args)...);
+  } catch (...) {
+    archetype.deallocateLast();
+    throw;
+  }
+
+  migrate(id, target, row);
+  return *result;
+}
+
+template <typename Fn>
+void ArchetypeStorage::createEntities(std::span<const EntityId> ids, ComponentSignature signature, Fn&& construct) {
+  const uint32_t target = findOrCreateArchetype(signature);
+  Archetype& archetype = *_archetypes[target];
+
+  for (EntityId id : ids) {
+    if (_locations.size() <= id.index) {
+      _locations.resize(id.index + 1);
+    }
+    Archetype::Row row = archetype.allocate(id);
+    for (uint32_t column = 0; column < archetype.componentIds().size(); ++column) {
+      construct(archetype.at(row, column), archetype.componentIds()[column]);
+    }
+    _locations[id.index] = Location{target, row};
+  }
+}
+
+template <typename Fn>
+void ArchetypeStorage::forEachMatching(ComponentSignature mask, Fn&& fn) {
+  for (auto& archetype : _archetypes) {
+    if (archetype->size() > 0 && (archetype->signature() & mask) == mask) {
+      fn(*archetype);
+    }
+  }
+}
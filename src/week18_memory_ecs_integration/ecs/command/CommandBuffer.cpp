@@ -0,0 +1,184 @@
+#include "CommandBuffer.hpp"
+
+#include <algorithm>
+#include <span>
+#include <stdexcept>
+
+#include "../../memory/ThreadArenaRegistry.hpp"
+#include "../World.hpp"
+
+CommandBuffer::CommandBuffer(uint32_t slot) : _slot(slot) {}
+
+CommandBuffer::~CommandBuffer() {
+  clear();
+}
+
+EntityId CommandBuffer::createEntity() {
+  if (_pendingCount >= (1u << PendingLocalBits)) {
+    throw std::runtime_error("Too many pending entities in one frame");
+  }
+  EntityId id{(_slot << PendingLocalBits) | _pendingCount++, PendingGeneration};
+  record(CommandType::Create, id);
+  return id;
+}
+
+void CommandBuffer::destroyEntity(EntityId id) {
+  record(CommandType::Destroy, id);
+}
+
+void* CommandBuffer::allocate(size_t bytes, size_t alignment) {
+  if (!_arena) {
+    // Without a thread arena, continue in the block kept from the last frame
+    _arena = ThreadArenaRegistry::get();
+    if (!_arena) {
+      _arena = _fallbackArena.get();
+    }
+  }
+  void* memory = _arena ? _arena->allocateRaw(bytes, alignment) : nullptr;
+  if (memory) {
+    return memory;
+  }
+
+  // No thread arena or it is full, continue in a heap block owned by the buffer
+  size_t blockSize = _fallbackBlocks.empty() ? FallbackArenaSize : _fallbackArena->capacity() * 2;
+  while (blockSize < bytes + alignment) {
+    blockSize *= 2;
+  }
+  _fallbackBlocks.push_back(std::make_unique<std::byte[]>(blockSize));
+  _fallbackArena = std::make_unique<FrameArena>(std::span<std::byte>(_fallbackBlocks.back().get(), blockSize));
+  _arena = _fallbackArena.get();
+  return _arena->allocateRaw(bytes, alignment);
+}
+
+CommandBuffer::Command& CommandBuffer::record(CommandType type, EntityId entity) {
+  auto* command = static_cast<Command*>(allocate(sizeof(Command), alignof(Command)));
+  *command = Command{type, _sortKey, entity, nullptr, nullptr, nullptr, nullptr};
+
+  if (_tail) {
+    _tail->next = command;
+  } else {
+    _head = command;
+  }
+  _tail = command;
+  ++_size;
+  return *command;
+}
+
+void CommandBuffer::clear() {
+  for (Command* command = _head; command; command = command->next) {
+    if (command->destroy) {
+      command->destroy(command->payload);
+    }
+  }
+  _head = nullptr;
+  _tail = nullptr;
+  _size = 0;
+  _pendingCount = 0;
+  _arena = nullptr;
+
+  // Keep the largest fallback block around for the next frame
+  if (_fallbackBlocks.size() > 1) {
+    _fallbackBlocks.erase(_fallbackBlocks.begin(), _fallbackBlocks.end() - 1);
+  }
+  if (_fallbackArena) {
+    _fallbackArena->reset();
+  }
+}
+
+CommandBuffer& CommandQueue::local() {
+  struct Cached {
+    uint64_t queue = 0;
+    CommandBuffer* buffer = nullptr;
+  };
+  thread_local Cached cached;
+  if (cached.queue == _id) {
+    return *cached.buffer;
+  }
+
+  std::lock_guard lock(_mutex);
+  auto it = _threadBuffers.find(std::this_thread::get_id());
+  if (it == _threadBuffers.end()) {
+    const uint32_t slot = static_cast<uint32_t>(_buffers.size());
+    if (slot >= (1u << CommandBuffer::PendingSlotBits)) {
+      throw std::runtime_error("Too many threads recording commands");
+    }
+    _buffers.push_back(std::make_unique<CommandBuffer>(slot));
+    it = _threadBuffers.emplace(std::this_thread::get_id(), _buffers.back().get()).first;
+  }
+  cached = Cached{_id, it->second};
+  return *it->second;
+}
+
+void CommandQueue::flush(World& world) {
+  using Command = CommandBuffer::Command;
+  using CommandType = CommandBuffer::CommandType;
+
+  std::lock_guard lock(_mutex);
+
+  // Buffers are gathered in slot order, the stable sort keeps that and the
+  // recording order for commands with the same key
+  _ordered.clear();
+  _resolved.resize(_buffers.size());
+  for (auto& buffer : _buffers) {
+    for (Command* command = buffer->_head; command; command = command->next) {
+      _ordered.push_back(command);
+    }
+    _resolved[buffer->_slot].assign(buffer->_pendingCount, EntityId{0, CommandBuffer::PendingGeneration});
+  }
+  std::stable_sort(_ordered.begin(), _ordered.end(), [](const Command* a, const Command* b) {
+    return a->sortKey < b->sortKey;
+  });
+
+  try {
+    for (Command* command : _ordered) {
+      if (command->type == CommandType::Create) {
+        const uint32_t slot = command->entity.index >> CommandBuffer::PendingLocalBits;
+        const uint32_t local = command->entity.index & ((1u << CommandBuffer::PendingLocalBits) - 1);
+        _resolved[slot][local] = world.createEntity();
+      }
+    }
+
+    for (Command* command : _ordered) {
+      const EntityId id = resolve(command->entity);
+      switch (command->type) {
+        case CommandType::Create:
+          break;
+        case CommandType::Destroy:
+          world.destroyEntity(id);
+          break;
+        case CommandType::Add:
+        case CommandType::Remove:
+          if (command->apply && world.isAlive(id)) {
+            command->apply(world, id, command->payload);
+          }
+          break;
+      }
+    }
+  } catch (...) {
+    for (auto& buffer : _buffers) {
+      buffer->clear();
+    }
+    throw;
+  }
+
+  for (auto& buffer : _buffers) {
+    buffer->clear();
+  }
+}
+
+bool CommandQueue::empty() const {
+  std::lock_guard lock(_mutex);
+  return std::all_of(_buffers.begin(), _buffers.end(), [](const auto& buffer) { return buffer->empty(); });
+}
+
+EntityId CommandQueue::resolve(EntityId id) const {
+  if (!CommandBuffer::isPending(id)) {
+    return id;
+  }
+  const uint32_t slot = id.index >> CommandBuffer::PendingLocalBits;
+  const uint32_t local = id.index & ((1u << CommandBuffer::PendingLocalBits) - 1);
+  if (slot >= _resolved.size() || local >= _resolved[slot].size()) {
+    return EntityId{0, CommandBuffer::PendingGeneration};
+  }
+  return _resolved[slot][local];
+}
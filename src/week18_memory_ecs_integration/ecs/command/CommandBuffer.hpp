@@ -0,0 +1,166 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "../../memory/FrameArena.hpp"
+#include "../component/ComponentConcepts.hpp"
+#include "../entity/EntityId.hpp"
+
+class World;
+
+//
+//  Deferred structural edits
+//
+//  Systems that run in parallel may not create/destroy entities or add/remove
+//  components directly. They record the edit into the CommandBuffer of the thread
+//  they run on instead, and the World plays every buffer back at a sync point
+//  (World::flushCommands) once the task graph has completed.
+//
+//  Commands and their component payloads live in the recording thread's FrameArena
+//  (ThreadArenaRegistry). Threads without one, or whose arena is full, continue in heap
+//  blocks owned by the buffer. Buffers must be flushed before the thread arenas are
+//  reset for the next frame.
+//
+//  Entities created through a buffer get a pending placeholder id that is only valid
+//  for commands recorded in the same frame; it is resolved to a real id on playback.
+//
+class CommandBuffer {
+ public:
+  static constexpr uint32_t PendingGeneration = UINT32_MAX;
+  static constexpr uint32_t PendingSlotBits = 12;
+  static constexpr uint32_t PendingLocalBits = 32 - PendingSlotBits;
+  static constexpr size_t FallbackArenaSize = 64 * 1024;
+
+  explicit CommandBuffer(uint32_t slot);
+  ~CommandBuffer();
+
+  CommandBuffer(const CommandBuffer&) = delete;
+  CommandBuffer& operator=(const CommandBuffer&) = delete;
+
+  EntityId createEntity();
+  void destroyEntity(EntityId id);
+
+  template <ComponentType T, typename... Args>
+  void addComponent(EntityId id, Args&&... args);
+
+  template <ComponentType T>
+  void removeComponent(EntityId id);
+
+  // Commands play back ordered by (sort key, buffer, recording order). The scheduler
+  // sets the key from the system id, and the chunk for fanned out systems, before each
+  // update. Other work split over several threads should give every range its own key
+  // for a fully deterministic playback.
+  void setSortKey(uint32_t key) { _sortKey = key; }
+  uint32_t sortKey() const { return _sortKey; }
+
+  size_t size() const { return _size; }
+  bool empty() const { return _size == 0; }
+
+  static bool isPending(EntityId id) { return id.generation == PendingGeneration; }
+
+ private:
+  friend class CommandQueue;
+
+  enum class CommandType : uint8_t { Create, Destroy, Add, Remove };
+
+  struct Command {
+    CommandType type;
+    uint32_t sortKey;
+    EntityId entity;
+    void* payload;
+    void (*apply)(World&, EntityId, void*);
+    void (*destroy)(void*);
+    Command* next;
+  };
+
+  uint32_t _slot;
+  uint32_t _sortKey = 0;
+  uint32_t _pendingCount = 0;
+  size_t _size = 0;
+  Command* _head = nullptr;
+  Command* _tail = nullptr;
+
+  FrameArena* _arena = nullptr;
+  std::vector<std::unique_ptr<std::byte[]>> _fallbackBlocks;
+  std::unique_ptr<FrameArena> _fallbackArena;
+
+  void* allocate(size_t bytes, size_t alignment);
+  Command& record(CommandType type, EntityId entity);
+
+  // Drops every recorded command and destroys the payloads
+  void clear();
+
+  // Defined with the World
+  template <ComponentType T>
+  static void applyAdd(World& world, EntityId id, T& value);
+  template <ComponentType T>
+  static void applyRemove(World& world, EntityId id);
+};
+
+//
+//  The per-thread buffers of one World and their playback
+//
+class CommandQueue {
+ public:
+  CommandQueue() = default;
+  ~CommandQueue() = default;
+
+  CommandQueue(const CommandQueue&) = delete;
+  CommandQueue& operator=(const CommandQueue&) = delete;
+
+  // The calling thread's buffer, created on first use. Each thread remembers the
+  // buffer of the queue it recorded into last, so repeated calls take no lock.
+  CommandBuffer& local();
+
+  // Plays back every buffer into the world. Pending entities are created first, in
+  // command order, then every other command is applied in command order. Must not run
+  // concurrently with anything that records commands.
+  void flush(World& world);
+
+  bool empty() const;
+
+ private:
+  // Identifies the queue in the per-thread cache, never reused unlike its address
+  const uint64_t _id = _nextId.fetch_add(1, std::memory_order_relaxed);
+  static inline std::atomic<uint64_t> _nextId{1};
+
+  mutable std::mutex _mutex;
+  std::unordered_map<std::thread::id, CommandBuffer*> _threadBuffers;
+  std::vector<std::unique_ptr<CommandBuffer>> _buffers;
+
+  // Reused between flushes
+  std::vector<CommandBuffer::Command*> _ordered;
+  std::vector<std::vector<EntityId>> _resolved;
+
+  EntityId resolve(EntityId id) const;
+};
+
+template <ComponentType T, typename... Args>
+void CommandBuffer::addComponent(EntityId id, Args&&... args) {
+  // The command stays a no-op until its payload has been constructed
+  Command& command = record(CommandType::Add, id);
+  void* payload = allocate(sizeof(T), alignof(T));
+  std::construct_at(static_cast<T*>(payload), std::forward<Args>(args)...);
+
+  command.payload = payload;
+  command.apply = [](World& world, EntityId entity, void* data) {
+    applyAdd<T>(world, entity, *static_cast<T*>(data));
+  };
+  command.destroy = [](void* data) { std::destroy_at(static_cast<T*>(data)); };
+}
+
+template <ComponentType T>
+void CommandBuffer::removeComponent(EntityId id) {
+  Command& command = record(CommandType::Remove, id);
+  command.apply = [](World& world, EntityId entity, void*) {
+    applyRemove<T>(world, entity);
+  };
+}
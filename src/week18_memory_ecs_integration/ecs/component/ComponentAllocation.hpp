@@ -0,0 +1,20 @@
+#pragma once
+
+#include <cstdint>
+
+//
+//  Where the storage of a component type gets its memory, picked per type with
+//  World::registerComponent. Sparse storage only.
+//
+//    Heap   the default memory resource
+//    Pool   the world's size class pool, shared by every pooled storage. Arrays and
+//           sparse pages are recycled between storages, the pool's chunks are
+//           reported under the ComponentPool tag
+//    Frame  the world's transient arena. Components of the type only live until the
+//           next World::advanceFrame, which removes all of them and resets the arena.
+//
+enum class ComponentAllocation : uint8_t {
+  Heap,
+  Pool,
+  Frame
+};
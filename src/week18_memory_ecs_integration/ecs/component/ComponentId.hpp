@@ -1,14 +1,16 @@
 #pragma once
 
+#include <atomic>
 #include <cstdint>
 #include <string>
 
 using ComponentId = uint32_t;
 
-inline ComponentId nextComponentId = 0;
+// Types may be seen for the first time from worker threads
+inline std::atomic<ComponentId> nextComponentId{0};
 
 template <typename T>
 ComponentId GetComponentId() {
-  static const ComponentId id = nextComponentId++;
+  static const ComponentId id = nextComponentId.fetch_add(1, std::memory_order_relaxed);
   return id;
 }
\ No newline at end of file
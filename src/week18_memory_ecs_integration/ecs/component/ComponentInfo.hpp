@@ -15,6 +15,8 @@ struct ComponentInfo {
   size_t size;
   ComponentId id;
   std::function<void(World&, EntityId, const nlohmann::json&)> deserializeFn;
+  size_t alignment = 0;
+  bool triviallyCopyable = false;
 
   explicit operator bool() const {
     return !name.empty();
@@ -3,20 +3,41 @@
 #include <cassert>
 #include <iostream>
 #include <memory>
-#include <unordered_map>
+#include <memory_resource>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
 
+#include "../../memory/MemoryResources.hpp"
 #include "../entity/EntityId.hpp"
 #include "ComponentConcepts.hpp"
 #include "ComponentId.hpp"
+#include "ComponentSignature.hpp"
 #include "ComponentStorage.hpp"
 
+//
+//  Storages live in a dense table indexed by ComponentId, so resolving the storage of
+//  a type is one indexed load. Ids are small and handed out in first-use order.
+//
+//  Each storage allocates through its own TrackedResource, which counts the bytes
+//  of the storage. reportUsage publishes them under "Component/<name>" in the
+//  AllocatorTagRegistry.
+//
 class ComponentManager {
  public:
+  // The upstream resource is fixed by the call that creates the storage
   template <ComponentType T>
-  void registerStorage() {
+  void registerStorage(std::pmr::memory_resource* upstream = std::pmr::get_default_resource()) {
     ComponentId id = T::typeId();
-    if (_storages.count(id)) return;
-    _storages[id] = std::make_unique<ComponentStorage<T>>();
+    assert(id < MaxComponents && "Too many component types for ComponentSignature");
+    if (id >= _storages.size()) {
+      _storages.resize(id + 1);
+    }
+    if (_storages[id]) return;
+    _storages[id] = std::make_unique<ComponentStorage<T>>(&track(id, T::name(), upstream));
+    _storages[id]->setTick(_tick);
   }
 
   template <ComponentType T, typename... Args>
@@ -27,8 +48,7 @@ class ComponentManager {
 
   template <ComponentType T>
   T* get(EntityId entity) {
-    ComponentId id = T::typeId();
-    if (!_storages.count(id)) {
+    if (!rawStorage(T::typeId())) {
       throw std::runtime_error("Storage not registered for component!");
     }
     return storage<T>().get(entity);
@@ -44,25 +64,69 @@ class ComponentManager {
     storage<T>().remove(entity);
   }
 
+  void setTick(uint32_t tick) {
+    _tick = tick;
+    for (auto& storage : _storages)
+      if (storage) storage->setTick(tick);
+  }
+
   void clearAll() {
-    for (auto& [_, storage] : _storages)
-      storage->clear();
+    for (auto& storage : _storages)
+      if (storage) storage->clear();
+  }
+
+  // Moves every row of staging into the matching storages here, see IComponentStorage::moveInto
+  void mergeFrom(ComponentManager& staging, std::span<const EntityId> remap) {
+    for (ComponentId id = 0; id < staging._storages.size(); ++id) {
+      IComponentStorage* source = staging._storages[id].get();
+      if (!source || source->size() == 0) continue;
+      if (id >= _storages.size()) {
+        _storages.resize(id + 1);
+      }
+      if (!_storages[id]) {
+        _storages[id] = source->makeEmpty(&track(id, source->componentName(), std::pmr::get_default_resource()));
+        _storages[id]->setTick(_tick);
+      }
+      source->moveInto(*_storages[id], remap);
+    }
   }
 
   template <ComponentType T>
   ComponentStorage<T>& storage() const {
     ComponentId id = T::typeId();
-    assert(_storages.contains(id));
-    auto* base = _storages.at(id).get();
-    return *static_cast<ComponentStorage<T>*>(base);
+    if (id >= _storages.size() || !_storages[id]) {
+      throw std::runtime_error(std::string("No storage for component: ") + std::string(T::name()));
+    }
+    return *static_cast<ComponentStorage<T>*>(_storages[id].get());
   }
 
   IComponentStorage* rawStorage(ComponentId id) const {
-    auto it = _storages.find(id);
-    if (it != _storages.end()) return nullptr;
-    return it->second.get();
+    return id < _storages.size() ? _storages[id].get() : nullptr;
+  }
+
+  // Publishes the live bytes of every storage to the AllocatorTagRegistry
+  void reportUsage() {
+    for (auto& resource : _resources) {
+      if (resource) resource->report();
+    }
+  }
+
+  // Resource a registered storage allocates from
+  const TrackedResource* resource(ComponentId id) const {
+    return id < _resources.size() ? _resources[id].get() : nullptr;
   }
 
  private:
-  std::unordered_map<ComponentId, std::unique_ptr<IComponentStorage>> _storages;
+  // Declared before the storages so that they outlive them
+  std::vector<std::unique_ptr<TrackedResource>> _resources;
+  std::vector<std::unique_ptr<IComponentStorage>> _storages;
+  uint32_t _tick = 0;
+
+  TrackedResource& track(ComponentId id, std::string_view name, std::pmr::memory_resource* upstream) {
+    if (id >= _resources.size()) {
+      _resources.resize(id + 1);
+    }
+    _resources[id] = std::make_unique<TrackedResource>("Component/" + std::string(name), upstream);
+    return *_resources[id];
+  }
 };
\ No newline at end of file
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+//
+//  Type-erased lifetime operations for a component type, used by storages
+//  that move raw component bytes around without knowing T.
+//
+struct ComponentOps {
+  size_t size = 0;
+  size_t alignment = 0;
+  void (*moveConstruct)(void* dst, void* src) = nullptr;
+  void (*copyConstruct)(void* dst, const void* src) = nullptr;
+  void (*destroy)(void* ptr) = nullptr;
+
+  explicit operator bool() const {
+    return size != 0;
+  }
+
+  template <typename T>
+  static ComponentOps of() {
+    ComponentOps ops;
+    ops.size = sizeof(T);
+    ops.alignment = alignof(T);
+    ops.moveConstruct = [](void* dst, void* src) {
+      std::construct_at(static_cast<T*>(dst), std::move(*static_cast<T*>(src)));
+    };
+    if constexpr (std::is_copy_constructible_v<T>) {
+      ops.copyConstruct = [](void* dst, const void* src) {
+        std::construct_at(static_cast<T*>(dst), *static_cast<const T*>(src));
+      };
+    }
+    ops.destroy = [](void* ptr) {
+      std::destroy_at(static_cast<T*>(ptr));
+    };
+    return ops;
+  }
+};
@@ -4,6 +4,7 @@
 #include <nlohmann/json.hpp>
 #include <optional>
 #include <string_view>
+#include <type_traits>
 #include <unordered_map>
 #include <vector>
 
@@ -22,12 +23,14 @@ class ComponentRegistry {
 
     if (_components.size() <= id) {
       _components.resize(id + 1);
-      _components[id] = ComponentInfo{name, sizeof(T), id, std::move(deserializer)};
-      _nameToId[std::string(name)] = id;
     }
+    if (_components[id]) return;
+
+    _components[id] = ComponentInfo{name, sizeof(T), id, std::move(deserializer), alignof(T), std::is_trivially_copyable_v<T>};
+    _nameToId[std::string(name)] = id;
   }
 
-  void forEachRegisteredComponent(auto&& fn) {
+  void forEachRegisteredComponent(auto&& fn) const {
     for (ComponentId id = 0; id < _components.size(); ++id) {
       if (_components[id]) fn(id);
     }
@@ -39,7 +42,7 @@ class ComponentRegistry {
   }
 
   std::optional<ComponentId> getComponentIdByName(std::string_view name) const {
-    auto it = _nameToId.find(std::string(name));
+    auto it = _nameToId.find(name);
     if (it == _nameToId.end()) {
       return std::nullopt;
     }
@@ -48,5 +51,10 @@ class ComponentRegistry {
 
  private:
   std::vector<ComponentInfo> _components;
-  std::unordered_map<std::string, ComponentId> _nameToId;
+  // Transparent so lookups by string_view do not allocate
+  struct NameHash {
+    using is_transparent = void;
+    size_t operator()(std::string_view name) const { return std::hash<std::string_view>{}(name); }
+  };
+  std::unordered_map<std::string, ComponentId, NameHash, std::equal_to<>> _nameToId;
 };
\ No newline at end of file
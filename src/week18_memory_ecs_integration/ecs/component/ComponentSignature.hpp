@@ -0,0 +1,11 @@
+#pragma once
+
+#include <bitset>
+#include <cstddef>
+
+#include "ComponentId.hpp"
+
+// One bit per ComponentId, so the ids handed out by GetComponentId must stay below this
+inline constexpr size_t MaxComponents = 64;
+
+using ComponentSignature = std::bitset<MaxComponents>;
@@ -1,9 +1,18 @@
 #pragma once
 
+#include <algorithm>
 #include <cstddef>
-#include <iostream>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <memory>
 #include <memory_resource>
-#include <unordered_map>
+#include <span>
+#include <stdexcept>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
 
 #include "../entity/EntityId.hpp"
 #include "ComponentConcepts.hpp"
@@ -12,22 +21,71 @@ class IComponentStorage {
  public:
   virtual ~IComponentStorage() = default;
   virtual void remove(EntityId entity) = 0;
+  virtual void removeBatch(std::span<const EntityId> entities) = 0;
   virtual bool has(EntityId entity) const = 0;
   virtual void clear() = 0;
+  // Clears and hands every buffer back to the memory resource
+  virtual void release() = 0;
   virtual void cloneComponent(EntityId from, EntityId to) = 0;
   virtual size_t size() const = 0;
+  virtual std::span<const EntityId> entities() const = 0;
+  // The packed component rows, size() of them
+  virtual const void* rawData() const = 0;
+  virtual size_t rowSize() const = 0;
+  // Whether rows can be saved and restored as raw bytes with assignRaw
+  virtual bool triviallyCopyable() const = 0;
+  // Replaces every row with entities.size() rows of raw bytes, see ComponentStorage::assign
+  virtual void assignRaw(std::span<const EntityId> entities, const void* rows) = 0;
+  virtual std::string_view componentName() const = 0;
+  // An empty storage of the same component type allocating from resource
+  virtual std::unique_ptr<IComponentStorage> makeEmpty(std::pmr::memory_resource* resource) const = 0;
+  // Moves every row into target, a storage of the same type, translating entity ids
+  // through remap (indexed by EntityId::index). Leaves this storage empty.
+  virtual void moveInto(IComponentStorage& target, std::span<const EntityId> remap) = 0;
+
+  // World frame counter stamped into the change ticks of touched components
+  void setTick(uint32_t tick) { _tick = tick; }
+  uint32_t tick() const { return _tick; }
+
+ protected:
+  uint32_t _tick = 0;
 };
 
+//
+//  Sparse set storage
+//
+//  _sparse is a paged array indexed by EntityId::index that holds the position of
+//  the entity's component inside the packed _components/_entities arrays. Pages are
+//  only allocated once an index inside of them is used.
+//
+//  Removal moves the last element into the hole (swap-and-pop), so the dense arrays
+//  are always contiguous and iteration is a linear scan. References returned from
+//  emplace/get are invalidated by any insert or removal on the same storage.
+//
+//  Every row also carries the tick it was added at and the tick it was last handed
+//  out mutably at (emplace and non-const get), which is what the Added<T>/Changed<T>
+//  view filters test against.
+//
+//  Every array and sparse page is allocated from the memory resource given at
+//  construction, which has to outlive the storage.
+//
 template <ComponentType T>
 class ComponentStorage : public IComponentStorage {
  public:
-  using MapType = std::pmr::unordered_map<EntityId, T>;
-  MapType::iterator begin() { return _components.begin(); }
-  MapType::iterator end() { return _components.end(); }
+  static constexpr uint32_t npos = std::numeric_limits<uint32_t>::max();
+  static constexpr size_t PageSize = 4096;
+
+  using Iterator = typename std::pmr::vector<T>::iterator;
+  Iterator begin() { return _components.begin(); }
+  Iterator end() { return _components.end(); }
+
+  ComponentStorage(std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+      : _resource(resource), _components(resource), _entities(resource), _addedTicks(resource), _changedTicks(resource), _sparse(resource) {}
 
-  ComponentStorage(std::pmr::memory_resource* resource = std::pmr::get_default_resource()) : _resource(resource) {}
+  ~ComponentStorage() {
+    releasePages();
+  }
 
-  ~ComponentStorage() = default;
   ComponentStorage(const ComponentStorage& other) noexcept = delete;
   ComponentStorage(ComponentStorage&& other) noexcept = delete;
   ComponentStorage& operator=(const ComponentStorage& other) noexcept = delete;
@@ -35,43 +93,311 @@ class ComponentStorage : public IComponentStorage {
 
   template <typename... Args>
   T& emplace(EntityId entity, Args&&... args) {
-    return _components.try_emplace(entity, std::forward<Args>(args)...).first->second;
+    uint32_t& slot = sparseSlot(entity.index);
+    if (slot != npos) {
+      if (_entities[slot] == entity) {
+        return _components[slot];
+      }
+      // A stale component from an older generation of this index, reuse its row
+      T& component = _components[slot];
+      std::destroy_at(&component);
+      std::construct_at(&component, std::forward<Args>(args)...);
+      _entities[slot] = entity;
+      _addedTicks[slot] = _tick;
+      _changedTicks[slot] = _tick;
+      return component;
+    }
+
+    T& component = _components.emplace_back(std::forward<Args>(args)...);
+    _entities.push_back(entity);
+    _addedTicks.push_back(_tick);
+    _changedTicks.push_back(_tick);
+    slot = static_cast<uint32_t>(_components.size() - 1);
+    return component;
   }
 
   void remove(EntityId entity) override {
-    _components.erase(entity);
+    const uint32_t pos = indexOf(entity);
+    if (pos == npos) return;
+
+    const uint32_t last = static_cast<uint32_t>(_components.size() - 1);
+    if (pos != last) {
+      _components[pos] = std::move(_components[last]);
+      _entities[pos] = _entities[last];
+      _addedTicks[pos] = _addedTicks[last];
+      _changedTicks[pos] = _changedTicks[last];
+      sparseAt(_entities[pos].index) = pos;
+    }
+    _components.pop_back();
+    _entities.pop_back();
+    _addedTicks.pop_back();
+    _changedTicks.pop_back();
+    sparseAt(entity.index) = npos;
+  }
+
+  // Entities without a component here are skipped. The doomed rows are unlinked
+  // first and then filled from the tail highest first, so only survivors are moved,
+  // and the arrays are truncated once.
+  void removeBatch(std::span<const EntityId> entities) override {
+    std::vector<uint32_t> doomed;
+    doomed.reserve(entities.size());
+    for (EntityId entity : entities) {
+      const uint32_t pos = indexOf(entity);
+      if (pos == npos) continue;
+      sparseAt(entity.index) = npos;
+      doomed.push_back(pos);
+    }
+    if (doomed.empty()) return;
+    std::sort(doomed.begin(), doomed.end(), std::greater<>());
+
+    uint32_t count = static_cast<uint32_t>(_components.size());
+    for (uint32_t pos : doomed) {
+      const uint32_t last = --count;
+      if (pos != last) {
+        _components[pos] = std::move(_components[last]);
+        _entities[pos] = _entities[last];
+        _addedTicks[pos] = _addedTicks[last];
+        _changedTicks[pos] = _changedTicks[last];
+        sparseAt(_entities[pos].index) = pos;
+      }
+    }
+    _components.erase(_components.begin() + count, _components.end());
+    _entities.resize(count);
+    _addedTicks.resize(count);
+    _changedTicks.resize(count);
   }
 
   bool has(EntityId entity) const override {
-    return _components.find(entity) != _components.end();
+    return indexOf(entity) != npos;
   }
 
   T* get(EntityId entity) {
-    auto it = _components.find(entity);
-    return it != _components.end() ? &it->second : nullptr;
+    const uint32_t pos = indexOf(entity);
+    if (pos == npos) return nullptr;
+    _changedTicks[pos] = _tick;
+    return &_components[pos];
   }
 
   const T* get(EntityId entity) const {
-    auto it = _components.find(entity);
-    return it != _components.end() ? &it->second : nullptr;
+    const uint32_t pos = indexOf(entity);
+    return pos != npos ? &_components[pos] : nullptr;
+  }
+
+  // Position of the entity inside the dense arrays or npos
+  uint32_t indexOf(EntityId entity) const {
+    const size_t page = entity.index / PageSize;
+    if (page >= _sparse.size() || !_sparse[page]) return npos;
+    const uint32_t pos = _sparse[page][entity.index % PageSize];
+    if (pos == npos || _entities[pos] != entity) return npos;
+    return pos;
   }
 
   template <typename Fn>
   void forEach(Fn&& fn) {
-    for (auto& [entity, component] : _components) {
-      fn(entity, component);
+    for (size_t i = 0; i < _components.size(); ++i) {
+      fn(_entities[i], _components[i]);
     }
   }
 
+  // Swaps two rows of the dense arrays, used by owning groups to keep their
+  // members packed at the front of the storage
+  void swapEntries(uint32_t a, uint32_t b) {
+    if (a == b) return;
+    std::swap(_components[a], _components[b]);
+    std::swap(_entities[a], _entities[b]);
+    std::swap(_addedTicks[a], _addedTicks[b]);
+    std::swap(_changedTicks[a], _changedTicks[b]);
+    sparseAt(_entities[a].index) = a;
+    sparseAt(_entities[b].index) = b;
+  }
+
+  // Gives every entity a copy of prototype after a single reserve, existing rows are
+  // copy-assigned. Entities without a row are appended with one bulk fill, which for
+  // trivially copyable components is a straight memory copy per row. Throws without
+  // touching any row if an index appears twice.
+  void emplaceCopies(std::span<const EntityId> entities, const T& prototype) {
+    reserve(_components.size() + entities.size());
+    const uint32_t first = static_cast<uint32_t>(_components.size());
+    auto dropAppended = [&] {
+      for (uint32_t pos = first; pos < _entities.size(); ++pos) {
+        sparseAt(_entities[pos].index) = npos;
+      }
+      _entities.resize(first);
+    };
+
+    // Claim slots for the new rows and check the whole batch for duplicates first,
+    // existing rows are only flagged, and only once the batch names one
+    std::vector<bool> overwritten;
+    for (EntityId entity : entities) {
+      uint32_t& slot = sparseSlot(entity.index);
+      if (slot == npos) {
+        slot = static_cast<uint32_t>(_entities.size());
+        _entities.push_back(entity);
+        continue;
+      }
+      if (slot < first) {
+        if (overwritten.empty()) overwritten.resize(first);
+        if (!overwritten[slot]) {
+          overwritten[slot] = true;
+          continue;
+        }
+      }
+      dropAppended();
+      throw std::runtime_error("Entity index appears twice in a batch");
+    }
+
+    const uint32_t count = static_cast<uint32_t>(_entities.size());
+    try {
+      _components.insert(_components.end(), count - first, prototype);
+    } catch (...) {
+      _components.erase(_components.begin() + first, _components.end());
+      dropAppended();
+      throw;
+    }
+    _addedTicks.resize(count, _tick);
+    _changedTicks.resize(count, _tick);
+    if (overwritten.empty()) return;
+
+    for (EntityId entity : entities) {
+      const uint32_t slot = sparseAt(entity.index);
+      if (slot >= first) continue;
+      _components[slot] = prototype;
+      if (_entities[slot] != entity) {
+        _entities[slot] = entity;
+        _addedTicks[slot] = _tick;
+      }
+      _changedTicks[slot] = _tick;
+    }
+  }
+
+  // Replaces every row with entities.size() components copied straight from rows,
+  // which may point into a mapped file. Only the sparse slots of the old rows are
+  // reset and nothing is allocated once the arrays are large enough.
+  void assign(std::span<const EntityId> entities, const T* rows)
+    requires std::is_trivially_copyable_v<T>
+  {
+    for (EntityId entity : _entities) {
+      sparseAt(entity.index) = npos;
+    }
+    _entities.assign(entities.begin(), entities.end());
+    _components.assign(rows, rows + entities.size());
+    _addedTicks.assign(entities.size(), _tick);
+    _changedTicks.assign(entities.size(), _tick);
+    for (uint32_t pos = 0; pos < entities.size(); ++pos) {
+      sparseSlot(entities[pos].index) = pos;
+    }
+  }
+
+  size_t rowSize() const override { return sizeof(T); }
+
+  bool triviallyCopyable() const override { return std::is_trivially_copyable_v<T>; }
+
+  void assignRaw(std::span<const EntityId> entities, const void* rows) override {
+    if constexpr (std::is_trivially_copyable_v<T>) {
+      assign(entities, static_cast<const T*>(rows));
+    } else {
+      throw std::runtime_error("Raw rows need a trivially copyable component");
+    }
+  }
+
+  std::string_view componentName() const override { return T::name(); }
+
+  std::unique_ptr<IComponentStorage> makeEmpty(std::pmr::memory_resource* resource) const override {
+    return std::make_unique<ComponentStorage>(resource);
+  }
+
+  void moveInto(IComponentStorage& target, std::span<const EntityId> remap) override {
+    auto& destination = static_cast<ComponentStorage&>(target);
+    destination.reserve(destination.size() + _components.size());
+    for (size_t pos = 0; pos < _components.size(); ++pos) {
+      destination.emplace(remap[_entities[pos].index], std::move(_components[pos]));
+    }
+    clear();
+  }
+
   void cloneComponent(EntityId from, EntityId to) override {
-    if (!has(from)) return;
-    _components.try_emplace(to, _components.at(from));
+    // Through the const get, reading the source must not mark it changed
+    const T* source = std::as_const(*this).get(from);
+    if (!source) return;
+    T copy = *source;
+    emplace(to, std::move(copy));
+  }
+
+  uint32_t addedTick(uint32_t pos) const { return _addedTicks[pos]; }
+  uint32_t changedTick(uint32_t pos) const { return _changedTicks[pos]; }
+
+  // Stamps the current tick on a range of rows that was handed out mutably by index
+  void markChanged(size_t begin, size_t end) {
+    std::fill(_changedTicks.begin() + begin, _changedTicks.begin() + end, _tick);
   }
 
-  void clear() override { _components.clear(); }
+  void reserve(size_t count) {
+    _components.reserve(count);
+    _entities.reserve(count);
+    _addedTicks.reserve(count);
+    _changedTicks.reserve(count);
+  }
+
+  void clear() override {
+    _components.clear();
+    _entities.clear();
+    _addedTicks.clear();
+    _changedTicks.clear();
+    for (uint32_t* page : _sparse) {
+      if (page) std::fill_n(page, PageSize, npos);
+    }
+  }
+
+  void release() override {
+    std::pmr::vector<T>(_resource).swap(_components);
+    std::pmr::vector<EntityId>(_resource).swap(_entities);
+    std::pmr::vector<uint32_t>(_resource).swap(_addedTicks);
+    std::pmr::vector<uint32_t>(_resource).swap(_changedTicks);
+    releasePages();
+    std::pmr::vector<uint32_t*>(_resource).swap(_sparse);
+  }
+
+  std::pmr::memory_resource* resource() const { return _resource; }
+
   size_t size() const override { return _components.size(); }
+  bool empty() const { return _components.empty(); }
+
+  T* data() { return _components.data(); }
+  const T* data() const { return _components.data(); }
+  std::span<const EntityId> entities() const override { return {_entities.data(), _entities.size()}; }
+  const void* rawData() const override { return _components.data(); }
 
  private:
-  std::pmr::unordered_map<EntityId, T> _components;
   std::pmr::memory_resource* _resource;
-};
\ No newline at end of file
+  std::pmr::vector<T> _components;
+  std::pmr::vector<EntityId> _entities;
+  std::pmr::vector<uint32_t> _addedTicks;
+  std::pmr::vector<uint32_t> _changedTicks;
+  std::pmr::vector<uint32_t*> _sparse;
+
+  void releasePages() {
+    for (uint32_t*& page : _sparse) {
+      if (page) {
+        _resource->deallocate(page, PageSize * sizeof(uint32_t), alignof(uint32_t));
+        page = nullptr;
+      }
+    }
+  }
+
+  uint32_t& sparseAt(uint32_t index) {
+    return _sparse[index / PageSize][index % PageSize];
+  }
+
+  uint32_t& sparseSlot(uint32_t index) {
+    const size_t page = index / PageSize;
+    if (page >= _sparse.size()) {
+      _sparse.resize(page + 1, nullptr);
+    }
+    if (!_sparse[page]) {
+      auto* memory = static_cast<uint32_t*>(_resource->allocate(PageSize * sizeof(uint32_t), alignof(uint32_t)));
+      std::fill_n(memory, PageSize, npos);
+      _sparse[page] = memory;
+    }
+    return _sparse[page][index % PageSize];
+  }
+};
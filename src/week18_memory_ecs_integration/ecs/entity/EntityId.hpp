@@ -33,6 +33,9 @@ struct EntityId {
   }
 };
 
+// Never alive, index UINT32_MAX is never handed out
+inline constexpr EntityId NullEntity{UINT32_MAX, 0};
+
 // Hashing support for unordered_map
 namespace std {
 template <>
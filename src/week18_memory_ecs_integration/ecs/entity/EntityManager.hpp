@@ -1,8 +1,10 @@
 #pragma once
 
-#include <queue>
+#include <span>
 #include <vector>
 
+#include "../component/ComponentId.hpp"
+#include "../component/ComponentSignature.hpp"
 #include "EntityId.hpp"
 
 class EntityManager {
@@ -16,27 +18,58 @@ class EntityManager {
 
   EntityId create() {
     uint32_t index;
-    if (!_freeIndices.empty()) {
-      index = _freeIndices.front();
-      _freeIndices.pop();
+    if (hasFreeIndex()) {
+      index = popFreeIndex();
     } else {
       index = static_cast<uint32_t>(_generations.size());
       _generations.push_back(0);
+      _signatures.emplace_back();
     }
 
     return EntityId{index, _generations[index]};
   }
 
+  // Appends count new ids to out, recycling free indices first
+  void createBatch(size_t count, std::vector<EntityId>& out) {
+    out.reserve(out.size() + count);
+    while (count > 0 && hasFreeIndex()) {
+      const uint32_t index = popFreeIndex();
+      out.push_back(EntityId{index, _generations[index]});
+      --count;
+    }
+
+    const uint32_t first = static_cast<uint32_t>(_generations.size());
+    _generations.resize(first + count, 0);
+    _signatures.resize(first + count);
+    for (uint32_t index = first; index < first + count; ++index) {
+      out.push_back(EntityId{index, 0});
+    }
+  }
+
   void destroy(EntityId id) {
-    const uint32_t index = id.index;
-    if (index >= _generations.size()) {
-      return;
+    if (retire(id)) {
+      release(id.index);
+    }
+  }
+
+  // Kills the id without recycling its index yet, the signature is kept so the
+  // caller still knows which storages to clean up before calling release
+  bool retire(EntityId id) {
+    if (!isAlive(id)) {
+      return false;
     }
-    if (_generations[index] != id.generation) {
-      return;
+    ++_generations[id.index];
+    return true;
+  }
+
+  void release(uint32_t index) {
+    _signatures[index].reset();
+    // Compact once the consumed front outweighs what is left
+    if (_freeHead > 64 && _freeHead * 2 > _freeIndices.size()) {
+      _freeIndices.erase(_freeIndices.begin(), _freeIndices.begin() + _freeHead);
+      _freeHead = 0;
     }
-    ++_generations[index];
-    _freeIndices.push(index);
+    _freeIndices.push_back(index);
   }
 
   bool isAlive(EntityId id) const {
@@ -54,7 +87,72 @@ class EntityManager {
     return _generations[index];
   }
 
+  // The components a live entity has, callers are expected to have checked isAlive
+  const ComponentSignature& signature(EntityId id) const {
+    return _signatures[id.index];
+  }
+
+  void setSignature(EntityId id, ComponentSignature signature) {
+    _signatures[id.index] = signature;
+  }
+
+  void addComponent(EntityId id, ComponentId component) {
+    _signatures[id.index].set(component);
+  }
+
+  void removeComponent(EntityId id, ComponentId component) {
+    _signatures[id.index].reset(component);
+  }
+
+  std::span<const uint32_t> generations() const {
+    return _generations;
+  }
+
+  std::span<const ComponentSignature> signatures() const {
+    return _signatures;
+  }
+
+  // Free indices in the order they will be recycled
+  std::span<const uint32_t> freeIndices() const {
+    return std::span<const uint32_t>(_freeIndices).subspan(_freeHead);
+  }
+
+  // Replaces every entity. Signatures start out empty unless given one per entity.
+  // Does not allocate once the arrays have grown to the restored size.
+  void restore(std::span<const uint32_t> generations, std::span<const uint32_t> freeIndices,
+               std::span<const ComponentSignature> signatures = {}) {
+    _generations.assign(generations.begin(), generations.end());
+    if (signatures.empty()) {
+      _signatures.assign(_generations.size(), ComponentSignature{});
+    } else {
+      _signatures.assign(signatures.begin(), signatures.end());
+    }
+    _freeIndices.assign(freeIndices.begin(), freeIndices.end());
+    _freeHead = 0;
+  }
+
+  // Alive and has every component in mask
+  bool matches(EntityId id, const ComponentSignature& mask) const {
+    return isAlive(id) && (_signatures[id.index] & mask) == mask;
+  }
+
  private:
   std::vector<uint32_t> _generations;
-  std::queue<uint32_t> _freeIndices;
+  std::vector<ComponentSignature> _signatures;
+  // FIFO of released indices, consumed from _freeHead
+  std::vector<uint32_t> _freeIndices;
+  size_t _freeHead = 0;
+
+  bool hasFreeIndex() const {
+    return _freeHead < _freeIndices.size();
+  }
+
+  uint32_t popFreeIndex() {
+    const uint32_t index = _freeIndices[_freeHead++];
+    if (_freeHead == _freeIndices.size()) {
+      _freeIndices.clear();
+      _freeHead = 0;
+    }
+    return index;
+  }
 };
\ No newline at end of file
@@ -5,19 +5,19 @@
 EntityRef::EntityRef(EntityId id, World* world)
     : id(id), world(world) {}
 
-void EntityRef::addTag(std::string_view tag) {
+void EntityRef::addTag(TagKey tag) {
   world->addTag(id, tag);
 }
 
-void EntityRef::removeTag(std::string_view tag) {
+void EntityRef::removeTag(TagKey tag) {
   world->removeTag(id, tag);
 }
 
-bool EntityRef::hasTag(std::string_view tag) const {
+bool EntityRef::hasTag(TagKey tag) const {
   return world->hasTag(id, tag);
 }
 
-const std::unordered_set<unsigned int>& EntityRef::tags() const {
+std::vector<TagKey> EntityRef::tags() const {
   return world->getTags(id);
 }
 
@@ -1,9 +1,10 @@
 #pragma once
 
 #include <string_view>
-#include <unordered_set>
+#include <vector>
 
 #include "EntityId.hpp"
+#include "TagSymbol.hpp"
 
 class World;
 
@@ -25,10 +26,10 @@ class EntityRef {
   template <typename T>
   void remove();
 
-  void addTag(std::string_view tag);
-  void removeTag(std::string_view tag);
-  bool hasTag(std::string_view tag) const;
-  const std::unordered_set<unsigned int>& tags() const;
+  void addTag(TagKey tag);
+  void removeTag(TagKey tag);
+  bool hasTag(TagKey tag) const;
+  std::vector<TagKey> tags() const;
   bool alive() const;
 
  private:
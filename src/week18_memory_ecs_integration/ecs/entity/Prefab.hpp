@@ -0,0 +1,73 @@
+#pragma once
+
+#include <memory>
+#include <span>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "../archetype/ArchetypeStorage.hpp"
+#include "../component/ComponentConcepts.hpp"
+#include "../component/ComponentId.hpp"
+#include "../component/ComponentManager.hpp"
+#include "../component/ComponentSignature.hpp"
+#include "EntityId.hpp"
+
+//
+//  A prefab is a set of prototype components. World::instantiate stamps out N
+//  entities from it, writing each component type for the whole batch in one pass
+//  instead of going through addComponent per entity.
+//
+//      Prefab bullet;
+//      bullet.with<Position>(0.0f, 0.0f).with<Velocity>(0.0f, 10.0f);
+//      world.instantiate(bullet, 1000);
+//
+class Prefab {
+ public:
+  template <ComponentType T, typename... Args>
+  Prefab& with(Args&&... args);
+
+  ComponentSignature signature() const { return _signature; }
+  size_t componentCount() const { return _entries.size(); }
+
+ private:
+  friend class World;
+
+  struct Entry {
+    ComponentId component;
+    std::shared_ptr<const void> prototype;
+    void (*emplaceSparse)(ComponentManager&, std::span<const EntityId>, const void*);
+    void (*registerArchetype)(ArchetypeStorage&);
+    void (*copyConstruct)(void*, const void*);
+  };
+
+  std::vector<Entry> _entries;
+  ComponentSignature _signature;
+};
+
+template <ComponentType T, typename... Args>
+Prefab& Prefab::with(Args&&... args) {
+  static_assert(std::is_copy_constructible_v<T>, "Prefab components have to be copyable");
+
+  Entry entry{
+      T::typeId(),
+      std::make_shared<const T>(std::forward<Args>(args)...),
+      [](ComponentManager& manager, std::span<const EntityId> ids, const void* prototype) {
+        manager.registerStorage<T>();
+        manager.storage<T>().emplaceCopies(ids, *static_cast<const T*>(prototype));
+      },
+      [](ArchetypeStorage& storage) { storage.registerComponent<T>(); },
+      [](void* destination, const void* prototype) {
+        std::construct_at(static_cast<T*>(destination), *static_cast<const T*>(prototype));
+      }};
+
+  for (Entry& existing : _entries) {
+    if (existing.component == entry.component) {
+      existing = std::move(entry);
+      return *this;
+    }
+  }
+  _entries.push_back(std::move(entry));
+  _signature.set(T::typeId());
+  return *this;
+}
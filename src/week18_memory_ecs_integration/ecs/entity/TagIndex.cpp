@@ -0,0 +1,103 @@
+#include "TagIndex.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+void TagIndex::add(TagId tag, uint32_t index) {
+  if (tag >= _tags.size()) {
+    _tags.resize(tag + 1);
+  }
+
+  Bits& words = _tags[tag];
+  const size_t word = index / 64;
+  if (word >= words.size()) {
+    const size_t blocks = word / WordsPerBlock + 1;
+    words.resize(blocks * WordsPerBlock, 0);
+  }
+  words[word] |= uint64_t{1} << (index % 64);
+}
+
+void TagIndex::remove(TagId tag, uint32_t index) {
+  if (tag >= _tags.size()) return;
+
+  Bits& words = _tags[tag];
+  const size_t word = index / 64;
+  if (word < words.size()) {
+    words[word] &= ~(uint64_t{1} << (index % 64));
+  }
+}
+
+bool TagIndex::has(TagId tag, uint32_t index) const {
+  return tag < _tags.size() && test(_tags[tag], index);
+}
+
+void TagIndex::clear(uint32_t index) {
+  const size_t word = index / 64;
+  const uint64_t mask = ~(uint64_t{1} << (index % 64));
+  for (Bits& words : _tags) {
+    if (word < words.size()) {
+      words[word] &= mask;
+    }
+  }
+}
+
+void TagIndex::copy(uint32_t src, uint32_t dst) {
+  for (TagId tag = 0; tag < _tags.size(); ++tag) {
+    if (test(_tags[tag], src)) {
+      add(tag, dst);
+    }
+  }
+}
+
+std::vector<TagId> TagIndex::tagsOf(uint32_t index) const {
+  std::vector<TagId> result;
+  for (TagId tag = 0; tag < _tags.size(); ++tag) {
+    if (test(_tags[tag], index)) {
+      result.push_back(tag);
+    }
+  }
+  return result;
+}
+
+TagIndex::Query TagIndex::query(std::span<const TagId> tags, const EntityManager& entities) const {
+  Query query;
+  query._entities = &entities;
+  if (tags.size() > MaxQueryTags) {
+    throw std::runtime_error("Tag queries support at most TagIndex::MaxQueryTags tags");
+  }
+  if (tags.empty()) {
+    return query;
+  }
+
+  size_t words = SIZE_MAX;
+  for (TagId tag : tags) {
+    if (tag >= _tags.size()) {
+      return query;
+    }
+    query._words[query._count++] = _tags[tag].data();
+    words = std::min(words, _tags[tag].size());
+  }
+
+  // Past the shortest bitset the AND is all zeroes
+  query._blocks = words / WordsPerBlock;
+  return query;
+}
+
+std::span<const uint64_t> TagIndex::bits(TagId tag) const {
+  if (tag >= _tags.size()) return {};
+  return _tags[tag];
+}
+
+void TagIndex::assign(TagId tag, std::span<const uint64_t> bits) {
+  if (tag >= _tags.size()) {
+    _tags.resize(tag + 1);
+  }
+  const size_t blocks = (bits.size() + WordsPerBlock - 1) / WordsPerBlock;
+  _tags[tag].assign(bits.begin(), bits.end());
+  _tags[tag].resize(blocks * WordsPerBlock, 0);
+}
+
+bool TagIndex::test(const Bits& words, uint32_t index) {
+  const size_t word = index / 64;
+  return word < words.size() && (words[word] >> (index % 64)) & 1;
+}
@@ -0,0 +1,131 @@
+#pragma once
+
+#include <emmintrin.h>
+
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "EntityId.hpp"
+#include "EntityManager.hpp"
+#include "TagSymbol.hpp"
+
+//
+//  Tags stored as one dense bitset per TagId, indexed by EntityId::index. Every bitset
+//  is kept at a multiple of 128 bits so that multi-tag queries can AND whole SSE
+//  registers. A tag's bitset is only as long as the highest index ever tagged with it.
+//
+//  Entities have to be untagged (clear) before their index is recycled.
+//
+class TagIndex {
+ public:
+  static constexpr size_t MaxQueryTags = 8;
+  static constexpr size_t BlockBits = 128;
+  static constexpr size_t WordsPerBlock = BlockBits / 64;
+
+  //
+  //  Lazily intersects up to MaxQueryTags bitsets 128 bits at a time and yields the
+  //  EntityId of every set bit. Holds pointers into the index, so it is invalidated
+  //  by any tag change.
+  //
+  class Query {
+   public:
+    class Iterator {
+     public:
+      Iterator(const Query* query, size_t block) : _query(query), _block(block) {
+        if (_block < _query->_blocks) {
+          load();
+          skipEmpty();
+        }
+      }
+
+      EntityId operator*() const {
+        const uint32_t index = static_cast<uint32_t>(_block * BlockBits + _word * 64 + std::countr_zero(_bits[_word]));
+        return EntityId{index, _query->_entities->generation(index)};
+      }
+
+      Iterator& operator++() {
+        _bits[_word] &= _bits[_word] - 1;
+        skipEmpty();
+        return *this;
+      }
+
+      bool operator==(const Iterator& other) const {
+        return _block == other._block && _word == other._word && _bits[0] == other._bits[0] && _bits[1] == other._bits[1];
+      }
+      bool operator!=(const Iterator& other) const { return !(*this == other); }
+
+     private:
+      const Query* _query;
+      size_t _block;
+      size_t _word = 0;
+      uint64_t _bits[WordsPerBlock] = {0, 0};
+
+      // ANDs the current 128 bit block of every queried tag
+      void load() {
+        const uint64_t* const* words = _query->_words.data();
+        __m128i acc = _mm_loadu_si128(reinterpret_cast<const __m128i*>(words[0] + _block * WordsPerBlock));
+        for (size_t t = 1; t < _query->_count; ++t) {
+          acc = _mm_and_si128(acc, _mm_loadu_si128(reinterpret_cast<const __m128i*>(words[t] + _block * WordsPerBlock)));
+        }
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(_bits), acc);
+        _word = 0;
+      }
+
+      void skipEmpty() {
+        while (_bits[_word] == 0) {
+          if (_word + 1 < WordsPerBlock) {
+            ++_word;
+          } else if (++_block < _query->_blocks) {
+            load();
+          } else {
+            _word = 0;
+            return;
+          }
+        }
+      }
+    };
+
+    Iterator begin() const { return Iterator{this, 0}; }
+    Iterator end() const { return Iterator{this, _blocks}; }
+    bool empty() const { return begin() == end(); }
+
+   private:
+    friend class TagIndex;
+
+    std::array<const uint64_t*, MaxQueryTags> _words{};
+    size_t _count = 0;
+    size_t _blocks = 0;
+    const EntityManager* _entities = nullptr;
+  };
+
+  void add(TagId tag, uint32_t index);
+  void remove(TagId tag, uint32_t index);
+  bool has(TagId tag, uint32_t index) const;
+
+  // Removes the index from every tag
+  void clear(uint32_t index);
+  // Gives dst every tag src has
+  void copy(uint32_t src, uint32_t dst);
+
+  std::vector<TagId> tagsOf(uint32_t index) const;
+
+  // Entities carrying every one of tags
+  Query query(std::span<const TagId> tags, const EntityManager& entities) const;
+
+  // Raw bitsets, a whole number of blocks each (snapshots)
+  size_t tagCount() const { return _tags.size(); }
+  std::span<const uint64_t> bits(TagId tag) const;
+  void assign(TagId tag, std::span<const uint64_t> bits);
+  void reset() { _tags.clear(); }
+
+ private:
+  using Bits = std::vector<uint64_t>;
+
+  std::vector<Bits> _tags;
+
+  static bool test(const Bits& bits, uint32_t index);
+};
@@ -0,0 +1,52 @@
+#include "TagRegistry.hpp"
+
+#include <mutex>
+#include <stdexcept>
+
+TagRegistry& TagRegistry::instance() {
+  static TagRegistry registry;
+  return registry;
+}
+
+TagId TagRegistry::intern(TagKey tag) {
+  {
+    std::shared_lock lock(_mutex);
+    if (auto id = lookup(tag)) return *id;
+  }
+
+  std::unique_lock lock(_mutex);
+  if (auto id = lookup(tag)) return *id;
+
+  const TagId id = static_cast<TagId>(_names.size());
+  _names.emplace_back(tag.name);
+  _symbols.push_back(tag.symbol);
+  _ids.emplace(tag.symbol, id);
+  return id;
+}
+
+std::optional<TagId> TagRegistry::find(TagKey tag) const {
+  std::shared_lock lock(_mutex);
+  return lookup(tag);
+}
+
+TagKey TagRegistry::tag(TagId id) const {
+  std::shared_lock lock(_mutex);
+  TagKey result;
+  result.symbol = _symbols[id];
+  result.name = _names[id];
+  return result;
+}
+
+size_t TagRegistry::size() const {
+  std::shared_lock lock(_mutex);
+  return _names.size();
+}
+
+std::optional<TagId> TagRegistry::lookup(TagKey tag) const {
+  auto it = _ids.find(tag.symbol);
+  if (it == _ids.end()) return std::nullopt;
+  if (_names[it->second] != tag.name) {
+    throw std::runtime_error("Tag hash collision between '" + _names[it->second] + "' and '" + std::string(tag.name) + "'");
+  }
+  return it->second;
+}
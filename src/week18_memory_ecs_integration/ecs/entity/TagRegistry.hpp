@@ -0,0 +1,43 @@
+#pragma once
+
+#include <deque>
+#include <optional>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "TagSymbol.hpp"
+
+//
+//  Process wide intern table for tags. Every distinct tag name gets a small dense
+//  TagId in registration order. Registering a name whose hash is already taken by a
+//  different name throws instead of silently merging the two tags.
+//
+class TagRegistry {
+ public:
+  static TagRegistry& instance();
+
+  // Returns the tag's id, registering it on first use
+  TagId intern(TagKey tag);
+
+  // Returns the tag's id if it has been registered
+  std::optional<TagId> find(TagKey tag) const;
+
+  // The interned tag, its name stays valid for the lifetime of the program
+  TagKey tag(TagId id) const;
+
+  size_t size() const;
+
+ private:
+  TagRegistry() = default;
+
+  mutable std::shared_mutex _mutex;
+  std::unordered_map<TagSymbol, TagId> _ids;
+  std::vector<TagSymbol> _symbols;
+  // Deque so the names never move once interned
+  std::deque<std::string> _names;
+
+  // Expects at least a shared lock
+  std::optional<TagId> lookup(TagKey tag) const;
+};
@@ -1,11 +1,47 @@
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
-#include <functional>
+#include <string>
 #include <string_view>
 
 using TagSymbol = uint32_t;
 
+// Dense id handed out by the TagRegistry, usable as a bitset index
+using TagId = uint32_t;
+
+// 32 bit FNV-1a, usable at compile time
+constexpr TagSymbol hashTag(std::string_view tag) {
+  TagSymbol hash = 2166136261u;
+  for (char c : tag) {
+    hash ^= static_cast<uint8_t>(c);
+    hash *= 16777619u;
+  }
+  return hash;
+}
+
 inline TagSymbol toTagSymbol(std::string_view tag) {
-  return static_cast<TagSymbol>(std::hash<std::string_view>{}(tag));
-}
\ No newline at end of file
+  return hashTag(tag);
+}
+
+//
+//  A tag name together with its hash. Literal tags ("enemy"_tag) are hashed at compile
+//  time, the name is kept so the TagRegistry can detect hash collisions.
+//
+struct TagKey {
+  TagSymbol symbol = 0;
+  std::string_view name;
+
+  constexpr TagKey() = default;
+  constexpr TagKey(std::string_view tag) : symbol(hashTag(tag)), name(tag) {}
+  constexpr TagKey(const char* tag) : TagKey(std::string_view(tag)) {}
+  TagKey(const std::string& tag) : TagKey(std::string_view(tag)) {}
+
+  constexpr bool operator==(const TagKey& other) const {
+    return symbol == other.symbol && name == other.name;
+  }
+};
+
+consteval TagKey operator""_tag(const char* tag, size_t length) {
+  return TagKey{std::string_view(tag, length)};
+}
@@ -0,0 +1,195 @@
+#pragma once
+
+#include <cstddef>
+#include <span>
+#include <tuple>
+
+#include "../../tasks/JobSystem.hpp"
+#include "../ViewFilters.hpp"
+#include "../component/ComponentConcepts.hpp"
+#include "../component/ComponentSignature.hpp"
+#include "../component/ComponentStorage.hpp"
+#include "../entity/EntityId.hpp"
+
+//
+//  Owning groups
+//
+//  A group owns the storages of its component types and keeps them sorted so that
+//  every entity that has all of them sits in the same leading range [0, size()) of
+//  each dense array. Iterating a group is lock-step pointer increments with no lookups.
+//
+//  Two groups may only share owned storages when one owns a subset of the other's
+//  types (nested groups). The more restrictive group then occupies a prefix of the
+//  less restrictive one. The World keeps every group up to date through the hooks
+//  below, so owned storages must only be mutated through the World.
+//
+//  Ts are view arguments without Changed/Added filters. const T is handed out
+//  read-only, every other component mutably, and each() and parallelEach() stamp the
+//  changed tick of the mutable components in the visited range.
+//
+//  Groups over the same components in another order or constness share the
+//  membership of the first one created. They are never notified themselves and read
+//  its size.
+//
+class IGroup {
+ public:
+  virtual ~IGroup() = default;
+
+  // Called after the entity gained one of the owned components
+  virtual void onAdded(EntityId entity) = 0;
+  // Called before the entity loses one of the owned components
+  virtual void onRemoving(EntityId entity) = 0;
+  // Re-sorts the owned storages from scratch
+  virtual void rebuild() = 0;
+
+  ComponentSignature owned() const { return _owned; }
+  size_t size() const { return _membership->_size; }
+  bool empty() const { return size() == 0; }
+
+ protected:
+  ComponentSignature _owned;
+  size_t _size = 0;
+  // The group keeping the storages sorted, this one unless it shares membership
+  const IGroup* _membership = this;
+};
+
+template <ViewArgType... Ts>
+  requires(!HasTickFilter<Ts...>)
+class Group : public IGroup {
+  using StorageTuple = std::tuple<ComponentStorage<ComponentOf<Ts>>*...>;
+  using First = ComponentOf<std::tuple_element_t<0, std::tuple<Ts...>>>;
+
+  class Iterator {
+   public:
+    Iterator(const Group* group, size_t current) : _group(group), _current(current) {}
+
+    Iterator& operator++() {
+      ++_current;
+      return *this;
+    }
+
+    std::tuple<EntityId, typename ViewArg<Ts>::Pointer...> operator*() const {
+      return std::make_tuple(_group->entities()[_current], (_group->template column<Ts>() + _current)...);
+    }
+
+    bool operator==(const Iterator& other) const { return _current == other._current; }
+    bool operator!=(const Iterator& other) const { return !(*this == other); }
+
+   private:
+    const Group* _group;
+    size_t _current;
+  };
+
+ public:
+  explicit Group(ComponentStorage<ComponentOf<Ts>>&... storages) : _storages(&storages...) {
+    (_owned.set(ComponentOf<Ts>::typeId()), ...);
+  }
+
+  // Shares the membership of membership, a group owning the same components
+  Group(const IGroup& membership, ComponentStorage<ComponentOf<Ts>>&... storages) : Group(storages...) {
+    _membership = &membership;
+  }
+
+  void onAdded(EntityId entity) override {
+    if (contains(entity)) return;
+    const bool hasAll = std::apply([&](auto*... storages) { return (... && storages->has(entity)); }, _storages);
+    if (!hasAll) return;
+
+    std::apply([&](auto*... storages) { (storages->swapEntries(storages->indexOf(entity), static_cast<uint32_t>(_size)), ...); }, _storages);
+    ++_size;
+  }
+
+  void onRemoving(EntityId entity) override {
+    if (!contains(entity)) return;
+
+    --_size;
+    std::apply([&](auto*... storages) { (storages->swapEntries(storages->indexOf(entity), static_cast<uint32_t>(_size)), ...); }, _storages);
+  }
+
+  void rebuild() override {
+    _size = 0;
+
+    // Walk the smallest owned storage by index. Members are swapped down to _size,
+    // which is never past the current index, so nothing is visited twice.
+    const IComponentStorage* driver = nullptr;
+    auto consider = [&](const IComponentStorage* storage) {
+      if (!driver || storage->size() < driver->size()) {
+        driver = storage;
+      }
+    };
+    std::apply([&](auto*... storages) { (consider(storages), ...); }, _storages);
+
+    for (size_t i = 0; i < driver->size(); ++i) {
+      onAdded(driver->entities()[i]);
+    }
+  }
+
+  bool contains(EntityId entity) const {
+    const uint32_t pos = std::get<0>(_storages)->indexOf(entity);
+    return pos != ComponentStorage<First>::npos && pos < size();
+  }
+
+  std::span<const EntityId> entities() const {
+    return std::get<0>(_storages)->entities().first(size());
+  }
+
+  template <ComponentType T>
+  T* data() const {
+    return std::get<ComponentStorage<T>*>(_storages)->data();
+  }
+
+  Iterator begin() const {
+    markChanged(0, size());
+    return Iterator{this, 0};
+  }
+  Iterator end() const { return Iterator{this, size()}; }
+
+  // Calls fn(EntityId, Ts&...) for every member, const for read-only arguments
+  template <typename Fn>
+  void each(Fn&& fn) const {
+    eachRange(0, size(), fn);
+  }
+
+  // Same as each, split into grainSize ranges that run as jobs
+  template <typename Fn>
+  void parallelEach(JobSystem& jobs, Fn&& fn, size_t grainSize = 1024) const {
+    jobs.parallelFor(size(), grainSize, [this, &fn](size_t begin, size_t end) {
+      eachRange(begin, end, fn);
+    });
+  }
+
+  // Same as each for the members [begin, end)
+  template <typename Fn>
+  void eachRange(size_t begin, size_t end, Fn&& fn) const {
+    markChanged(begin, end);
+    const EntityId* ids = std::get<0>(_storages)->entities().data();
+    std::tuple<typename ViewArg<Ts>::Pointer...> pointers{column<Ts>()...};
+    std::apply(
+        [&](typename ViewArg<Ts>::Pointer... columns) {
+          for (size_t i = begin; i < end; ++i) {
+            fn(ids[i], columns[i]...);
+          }
+        },
+        pointers);
+  }
+
+ private:
+  StorageTuple _storages;
+
+  template <typename Arg>
+  typename ViewArg<Arg>::Pointer column() const {
+    return data<ComponentOf<Arg>>();
+  }
+
+  // Only the mutable arguments are stamped
+  void markChanged(size_t begin, size_t end) const {
+    (stamp<Ts>(begin, end), ...);
+  }
+
+  template <typename Arg>
+  void stamp(size_t begin, size_t end) const {
+    if constexpr (ViewArg<Arg>::Mutable) {
+      std::get<ComponentStorage<ComponentOf<Arg>>*>(_storages)->markChanged(begin, end);
+    }
+  }
+};
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstdint>
+
+#include "../../math/Mat4f.hpp"
+#include "../component/Component.hpp"
+#include "../entity/EntityId.hpp"
+
+//
+//  Parent/child links stored intrusively: every entity in a hierarchy knows its parent,
+//  its first child and its next sibling. Links are maintained by World::setParent and
+//  World::removeParent, depth is 0 for roots.
+//
+struct Hierarchy : public Component<Hierarchy> {
+  COMPONENT_NAME("Hierarchy");
+  EntityId parent = NullEntity;
+  EntityId firstChild = NullEntity;
+  EntityId nextSibling = NullEntity;
+  uint32_t depth = 0;
+};
+
+struct LocalTransform : public Component<LocalTransform> {
+  COMPONENT_NAME("LocalTransform");
+  LocalTransform() = default;
+  LocalTransform(const Mat4f& m) : matrix(m) {}
+  Mat4f matrix;
+};
+
+// Written by the TransformSystem
+struct WorldTransform : public Component<WorldTransform> {
+  COMPONENT_NAME("WorldTransform");
+  WorldTransform() = default;
+  WorldTransform(const Mat4f& m) : matrix(m) {}
+  Mat4f matrix;
+};
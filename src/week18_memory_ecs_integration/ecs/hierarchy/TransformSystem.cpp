@@ -0,0 +1,65 @@
+#include "TransformSystem.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+#include "../../math/Mat4fOps.hpp"
+#include "../../tasks/JobSystem.hpp"
+#include "../World.hpp"
+#include "Hierarchy.hpp"
+
+TransformSystem::TransformSystem(JobSystem& jobs, size_t grainSize) : _jobs(jobs), _grainSize(grainSize) {}
+
+void TransformSystem::update(World& world, float) {
+  if (world.storageMode() != StorageMode::Sparse) {
+    throw std::runtime_error("TransformSystem needs sparse storage");
+  }
+  ComponentStorage<Hierarchy>& hierarchy = world.storage<Hierarchy>();
+  ComponentStorage<LocalTransform>& locals = world.storage<LocalTransform>();
+  ComponentStorage<WorldTransform>& worlds = world.storage<WorldTransform>();
+
+  const Hierarchy* nodes = std::as_const(hierarchy).data();
+  const size_t count = hierarchy.size();
+
+  if (!std::is_sorted(nodes, nodes + count, [](const Hierarchy& a, const Hierarchy& b) { return a.depth < b.depth; })) {
+    _order.clear();
+    for (size_t i = 0; i < count; ++i) {
+      _order.emplace_back(nodes[i].depth, hierarchy.entities()[i]);
+    }
+    std::stable_sort(_order.begin(), _order.end(), [](const auto& a, const auto& b) { return a.first < b.first; });
+    for (uint32_t row = 0; row < count; ++row) {
+      hierarchy.swapEntries(row, hierarchy.indexOf(_order[row].second));
+    }
+    nodes = std::as_const(hierarchy).data();
+  }
+
+  _levelStarts.clear();
+  for (uint32_t row = 0; row < count; ++row) {
+    if (row == 0 || nodes[row].depth != nodes[row - 1].depth) {
+      _levelStarts.push_back(row);
+    }
+  }
+  _levelStarts.push_back(static_cast<uint32_t>(count));
+
+  const EntityId* ids = hierarchy.entities().data();
+  for (size_t level = 0; level + 1 < _levelStarts.size(); ++level) {
+    const uint32_t first = _levelStarts[level];
+    const uint32_t size = _levelStarts[level + 1] - first;
+
+    _jobs.parallelFor(size, _grainSize, [&](size_t begin, size_t end) {
+      for (size_t row = first + begin; row < first + end; ++row) {
+        const LocalTransform* local = std::as_const(locals).get(ids[row]);
+        WorldTransform* result = worlds.get(ids[row]);
+        if (!local || !result) continue;
+
+        const WorldTransform* parent =
+            nodes[row].parent != NullEntity ? std::as_const(worlds).get(nodes[row].parent) : nullptr;
+        if (parent) {
+          result->matrix = local->matrix * parent->matrix;
+        } else {
+          result->matrix = local->matrix;
+        }
+      }
+    });
+  }
+}
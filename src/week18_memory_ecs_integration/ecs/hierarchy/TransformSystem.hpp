@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <utility>
+#include <vector>
+
+#include "../entity/EntityId.hpp"
+#include "../system/System.hpp"
+
+class JobSystem;
+
+//
+//  Propagates WorldTransform = LocalTransform * parent's WorldTransform for every
+//  entity with a Hierarchy component, roots take their local transform as is.
+//
+//  The Hierarchy storage is kept sorted by depth, so each level is one contiguous range
+//  of it. Levels are processed in order and every level is split into parallel jobs,
+//  parents are always finished before their children read them. The sort only runs
+//  when a structural change left the storage out of order.
+//
+//  Sparse storage only. Hierarchy must not be owned by a group, the system reorders it.
+//
+class TransformSystem : public System {
+ public:
+  explicit TransformSystem(JobSystem& jobs, size_t grainSize = 256);
+
+  void update(World& world, float dt) override;
+  const char* name() const override { return "TransformSystem"; }
+
+  // Level d of the last update is rows [levelStarts[d], levelStarts[d + 1])
+  std::span<const uint32_t> levelStarts() const { return _levelStarts; }
+
+ private:
+  JobSystem& _jobs;
+  size_t _grainSize;
+  std::vector<uint32_t> _levelStarts;
+  std::vector<std::pair<uint32_t, EntityId>> _order;
+};
@@ -0,0 +1,227 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <limits>
+#include <mutex>
+#include <span>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "../../tasks/JobSystem.hpp"
+#include "../ViewFilters.hpp"
+#include "../archetype/Archetype.hpp"
+#include "../archetype/ArchetypeStorage.hpp"
+#include "../component/ComponentSignature.hpp"
+#include "../component/ComponentStorage.hpp"
+#include "../entity/EntityId.hpp"
+#include "../entity/EntityManager.hpp"
+
+//
+//  Persistent queries
+//
+//  A query caches what a View would have to find again on every call:
+//
+//    Sparse storage:    the list of matching entities, kept up to date by the World
+//                       through the hooks below whenever a component in the mask is
+//                       added or removed
+//    Archetype storage: the list of matching archetypes, extended with the ones
+//                       created since the last iteration
+//
+//  Systems resolve their query once in System::attach, keep it and iterate it without
+//  any filtering. Ts are view arguments without Changed/Added filters, const T yields
+//  read-only access.
+//
+class IQuery {
+ public:
+  virtual ~IQuery() = default;
+
+  // Called after the entity gained a component in the mask
+  virtual void onAdded(EntityId entity) = 0;
+  // Called before the entity loses a component in the mask
+  virtual void onRemoving(EntityId entity) = 0;
+  // Recomputes the cached entities from scratch
+  virtual void rebuild() = 0;
+
+  ComponentSignature mask() const { return _mask; }
+
+ protected:
+  ComponentSignature _mask;
+};
+
+template <ViewArgType... Ts>
+  requires(!HasTickFilter<Ts...>)
+class Query : public IQuery {
+  using StorageTuple = std::tuple<ComponentStorage<ComponentOf<Ts>>*...>;
+  static constexpr uint32_t npos = std::numeric_limits<uint32_t>::max();
+
+ public:
+  Query(const EntityManager& entities, ComponentStorage<ComponentOf<Ts>>&... storages)
+      : _entityManager(&entities), _storages(&storages...) {
+    (_mask.set(ComponentOf<Ts>::typeId()), ...);
+    rebuild();
+  }
+
+  explicit Query(ArchetypeStorage& archetypes) : _archetypeStorage(&archetypes) {
+    (_mask.set(ComponentOf<Ts>::typeId()), ...);
+  }
+
+  Query(const Query&) = delete;
+  Query& operator=(const Query&) = delete;
+
+  void onAdded(EntityId entity) override {
+    if (_archetypeStorage || contains(entity) || !_entityManager->matches(entity, _mask)) return;
+    if (entity.index >= _positions.size()) {
+      _positions.resize(entity.index + 1, npos);
+    }
+    _positions[entity.index] = static_cast<uint32_t>(_entities.size());
+    _entities.push_back(entity);
+  }
+
+  void onRemoving(EntityId entity) override {
+    if (!contains(entity)) return;
+    const uint32_t pos = _positions[entity.index];
+    const EntityId last = _entities.back();
+    _entities[pos] = last;
+    _positions[last.index] = pos;
+    _entities.pop_back();
+    _positions[entity.index] = npos;
+  }
+
+  void rebuild() override {
+    if (_archetypeStorage) {
+      std::lock_guard lock(_refreshMutex);
+      _archetypes.clear();
+      _archetypesSeen.store(0, std::memory_order_release);
+      return;
+    }
+
+    _entities.clear();
+    std::fill(_positions.begin(), _positions.end(), npos);
+
+    // Every match is in every storage, so walking the smallest one is enough
+    const IComponentStorage* driver = nullptr;
+    auto consider = [&](const IComponentStorage* storage) {
+      if (!driver || storage->size() < driver->size()) {
+        driver = storage;
+      }
+    };
+    std::apply([&](auto*... storages) { (consider(storages), ...); }, _storages);
+    for (EntityId entity : driver->entities()) {
+      onAdded(entity);
+    }
+  }
+
+  bool contains(EntityId entity) const {
+    return !_archetypeStorage && entity.index < _positions.size() && _positions[entity.index] != npos &&
+           _entities[_positions[entity.index]] == entity;
+  }
+
+  // Calls fn(EntityId, Ts&...) for every matching entity, const for read-only arguments
+  template <typename Fn>
+  void forEach(Fn&& fn) const {
+    if (_archetypeStorage) {
+      refreshArchetypes();
+      forEachArchetype(0, _archetypes.size(), fn);
+    } else {
+      forEachCached(0, _entities.size(), fn);
+    }
+  }
+
+  // Same as forEach, split into jobs of about grainSize entities (sparse) or over the
+  // matching archetypes (archetype storage). fn is called concurrently.
+  template <typename Fn>
+  void parallelForEach(JobSystem& jobs, Fn&& fn, size_t grainSize = 1024) const {
+    if (_archetypeStorage) {
+      refreshArchetypes();
+      jobs.parallelFor(_archetypes.size(), 1, [this, &fn](size_t begin, size_t end) {
+        forEachArchetype(begin, end, fn);
+      });
+      return;
+    }
+    jobs.parallelFor(_entities.size(), grainSize, [this, &fn](size_t begin, size_t end) {
+      forEachCached(begin, end, fn);
+    });
+  }
+
+  size_t size() const {
+    if (_archetypeStorage) {
+      refreshArchetypes();
+      size_t total = 0;
+      for (Archetype* archetype : _archetypes) total += archetype->size();
+      return total;
+    }
+    return _entities.size();
+  }
+
+  bool empty() const { return size() == 0; }
+
+  // The cached entities in iteration order, sparse storage only
+  std::span<const EntityId> entities() const { return _entities; }
+
+ private:
+  // Sparse storage
+  const EntityManager* _entityManager = nullptr;
+  StorageTuple _storages{};
+  std::vector<EntityId> _entities;
+  std::vector<uint32_t> _positions;
+
+  // Archetype storage. Systems may iterate the same query concurrently, so picking up
+  // new archetypes is serialized and published through _archetypesSeen.
+  ArchetypeStorage* _archetypeStorage = nullptr;
+  mutable std::vector<Archetype*> _archetypes;
+  mutable std::atomic<size_t> _archetypesSeen{0};
+  mutable std::mutex _refreshMutex;
+
+  void refreshArchetypes() const {
+    const size_t count = _archetypeStorage->archetypeCount();
+    if (_archetypesSeen.load(std::memory_order_acquire) == count) return;
+
+    std::lock_guard lock(_refreshMutex);
+    for (size_t i = _archetypesSeen.load(std::memory_order_relaxed); i < count; ++i) {
+      Archetype& archetype = _archetypeStorage->archetypeAt(i);
+      if ((archetype.signature() & _mask) == _mask) {
+        _archetypes.push_back(&archetype);
+      }
+    }
+    _archetypesSeen.store(count, std::memory_order_release);
+  }
+
+  template <typename Fn>
+  void forEachCached(size_t begin, size_t end, Fn& fn) const {
+    for (size_t i = begin; i < end; ++i) {
+      const EntityId id = _entities[i];
+      std::apply([&](auto*... storages) { fn(id, *fetch<Ts>(storages, id)...); }, _storages);
+    }
+  }
+
+  template <typename Fn>
+  void forEachArchetype(size_t begin, size_t end, Fn& fn) const {
+    for (size_t a = begin; a < end; ++a) {
+      Archetype& archetype = *_archetypes[a];
+      for (size_t chunk = 0; chunk < archetype.chunkCount(); ++chunk) {
+        const EntityId* entities = archetype.entities(chunk);
+        auto columns = std::make_tuple(static_cast<typename ViewArg<Ts>::Pointer>(
+            archetype.column(chunk, archetype.columnOf(ComponentOf<Ts>::typeId())))...);
+        std::apply(
+            [&](auto*... column) {
+              for (size_t row = 0; row < archetype.chunkSize(chunk); ++row) {
+                fn(entities[row], column[row]...);
+              }
+            },
+            columns);
+      }
+    }
+  }
+
+  // Mutable arguments go through the non-const get so the changed tick is stamped
+  template <typename Arg>
+  static typename ViewArg<Arg>::Pointer fetch(ComponentStorage<ComponentOf<Arg>>* storage, EntityId id) {
+    if constexpr (ViewArg<Arg>::Mutable) {
+      return storage->get(id);
+    } else {
+      return std::as_const(*storage).get(id);
+    }
+  }
+};
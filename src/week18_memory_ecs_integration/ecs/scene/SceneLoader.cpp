@@ -0,0 +1,112 @@
+#include "SceneLoader.hpp"
+
+#include <exception>
+#include <fstream>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+
+#include "../../tasks/JobSystem.hpp"
+
+static std::chrono::microseconds since(std::chrono::high_resolution_clock::time_point start) {
+  return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now() - start);
+}
+
+SceneLoader::SceneLoader(World& world, JobSystem& jobs) : _world(world), _jobs(jobs) {}
+
+std::vector<EntityId> SceneLoader::loadFile(const std::string& path) {
+  using Clock = std::chrono::high_resolution_clock;
+
+  auto start = Clock::now();
+  std::ifstream file(path, std::ios::binary);
+  if (!file) {
+    throw std::runtime_error("Could not open scene " + path);
+  }
+  std::stringstream buffer;
+  buffer << file.rdbuf();
+  const std::string text = buffer.str();
+  const auto read = since(start);
+
+  start = Clock::now();
+  const nlohmann::json scene = nlohmann::json::parse(text);
+  const auto parse = since(start);
+
+  std::vector<EntityId> ids = load(scene);
+  _stats.read = read;
+  _stats.parse = parse;
+  return ids;
+}
+
+std::vector<EntityId> SceneLoader::load(const nlohmann::json& scene) {
+  using Clock = std::chrono::high_resolution_clock;
+
+  _stats = SceneLoadStats{};
+  const nlohmann::json& entities = scene.at("entities");
+  if (!entities.is_array()) {
+    throw std::runtime_error("Scene entities have to be an array");
+  }
+
+  const size_t count = entities.size();
+  const size_t chunkCount = std::max<size_t>(1, std::min(count, _jobs.workerCount() + 1));
+  const size_t chunkSize = (count + chunkCount - 1) / chunkCount;
+  std::vector<World> staging(chunkCount);
+
+  // The first failure is reported once every chunk has finished
+  std::exception_ptr failure;
+  std::mutex failureMutex;
+
+  auto start = Clock::now();
+  _jobs.parallelFor(count, chunkSize, [&](size_t begin, size_t end) {
+    World& world = staging[begin / chunkSize];
+    try {
+      for (size_t i = begin; i < end; ++i) {
+        deserializeEntity(world, entities[i]);
+      }
+    } catch (...) {
+      std::lock_guard lock(failureMutex);
+      if (!failure) {
+        failure = std::current_exception();
+      }
+    }
+  });
+  if (failure) {
+    std::rethrow_exception(failure);
+  }
+  _stats.deserialize = since(start);
+
+  start = Clock::now();
+  std::vector<EntityId> ids;
+  ids.reserve(count);
+  for (World& world : staging) {
+    const std::vector<EntityId> merged = _world.merge(world);
+    ids.insert(ids.end(), merged.begin(), merged.end());
+  }
+  _stats.merge = since(start);
+
+  _stats.entities = ids.size();
+  _stats.chunks = chunkCount;
+  return ids;
+}
+
+void SceneLoader::deserializeEntity(World& staging, const nlohmann::json& entity) const {
+  const ComponentRegistry& registry = _world.getRegistry();
+  const EntityId id = staging.createEntity();
+
+  if (auto tags = entity.find("tags"); tags != entity.end()) {
+    for (const auto& tag : *tags) {
+      staging.addTag(id, tag.get_ref<const std::string&>());
+    }
+  }
+
+  auto components = entity.find("components");
+  if (components == entity.end()) return;
+
+  for (const auto& [name, data] : components->items()) {
+    auto component = registry.getComponentIdByName(name);
+    const ComponentInfo* info = component ? registry.getInfo(*component) : nullptr;
+    if (!info || !info->deserializeFn) {
+      throw std::runtime_error("Scene component " + name + " has no registered deserializer");
+    }
+    info->deserializeFn(staging, id, data);
+  }
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <nlohmann/json.hpp>
+#include <string>
+#include <vector>
+
+#include "../World.hpp"
+
+class JobSystem;
+
+struct SceneLoadStats {
+  size_t entities = 0;
+  size_t chunks = 0;
+  std::chrono::microseconds read{0};
+  std::chrono::microseconds parse{0};
+  std::chrono::microseconds deserialize{0};
+  std::chrono::microseconds merge{0};
+};
+
+//
+//  Loads JSON scenes through the component deserializers registered with the World
+//
+//      {
+//        "entities": [
+//          { "tags": ["enemy"], "components": { "Position": { "x": 1, "y": 2 } } }
+//        ]
+//      }
+//
+//  The entity array is split into one chunk per thread. Every chunk is deserialized
+//  on the JobSystem into its own staging World, the staging worlds are then merged
+//  into the target in chunk order with one batched pass per component type, so the
+//  returned ids follow the scene order.
+//
+//  Deserializers run on worker threads against a staging World, they must not touch
+//  anything but the World they are handed.
+//
+class SceneLoader {
+ public:
+  SceneLoader(World& world, JobSystem& jobs);
+
+  std::vector<EntityId> loadFile(const std::string& path);
+  std::vector<EntityId> load(const nlohmann::json& scene);
+
+  // Timings of the last load, read and parse are zero when handed parsed json
+  const SceneLoadStats& stats() const { return _stats; }
+
+ private:
+  World& _world;
+  JobSystem& _jobs;
+  SceneLoadStats _stats;
+
+  void deserializeEntity(World& staging, const nlohmann::json& entity) const;
+};
@@ -0,0 +1,41 @@
+#include "MappedFile.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <stdexcept>
+
+MappedFile::MappedFile(const std::string& path) {
+  const int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    throw std::runtime_error("Could not open " + path);
+  }
+
+  struct stat info {};
+  if (::fstat(fd, &info) != 0) {
+    ::close(fd);
+    throw std::runtime_error("Could not stat " + path);
+  }
+  _size = static_cast<size_t>(info.st_size);
+
+  if (_size > 0) {
+    void* data = ::mmap(nullptr, _size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (data == MAP_FAILED) {
+      ::close(fd);
+      throw std::runtime_error("Could not map " + path);
+    }
+    // Columns are read front to back once
+    ::madvise(data, _size, MADV_SEQUENTIAL);
+    _data = static_cast<const std::byte*>(data);
+  }
+  // The mapping keeps the file alive on its own
+  ::close(fd);
+}
+
+MappedFile::~MappedFile() {
+  if (_data) {
+    ::munmap(const_cast<std::byte*>(_data), _size);
+  }
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <cstddef>
+#include <span>
+#include <string>
+
+//
+//  Read-only memory mapping of a whole file (POSIX mmap). The bytes stay valid for
+//  the lifetime of the object.
+//
+class MappedFile {
+ public:
+  explicit MappedFile(const std::string& path);
+  ~MappedFile();
+
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  std::span<const std::byte> bytes() const { return {_data, _size}; }
+  size_t size() const { return _size; }
+
+ private:
+  const std::byte* _data = nullptr;
+  size_t _size = 0;
+};
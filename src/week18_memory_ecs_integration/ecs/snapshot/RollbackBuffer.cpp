@@ -0,0 +1,195 @@
+#include "RollbackBuffer.hpp"
+
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+#include "../World.hpp"
+
+// Bump cursor over one frame slot
+class FrameCursor {
+ public:
+  FrameCursor(std::byte* begin, size_t size) : _begin(begin), _size(size) {}
+
+  std::byte* take(size_t bytes, size_t alignment) {
+    _offset = (_offset + alignment - 1) / alignment * alignment;
+    if (_offset > _size || bytes > _size - _offset) {
+      throw std::runtime_error("Rollback frame does not fit in " + std::to_string(_size) + " bytes");
+    }
+    std::byte* data = _begin + _offset;
+    _offset += bytes;
+    return data;
+  }
+
+  template <typename T>
+  T* take(size_t count) {
+    return reinterpret_cast<T*>(take(count * sizeof(T), alignof(T)));
+  }
+
+  // Always advances the cursor, even for empty spans, so reads line up with writes
+  template <typename T>
+  void write(std::span<const T> values) {
+    T* destination = take<T>(values.size());
+    if (!values.empty()) {
+      std::memcpy(destination, values.data(), values.size_bytes());
+    }
+  }
+
+  size_t offset() const { return _offset; }
+
+ private:
+  std::byte* _begin;
+  size_t _size;
+  size_t _offset = 0;
+};
+
+RollbackBuffer::RollbackBuffer(size_t frameCount, size_t bytesPerFrame)
+    : _frameCount(frameCount), _bytesPerFrame((bytesPerFrame + Alignment - 1) / Alignment * Alignment) {
+  if (_frameCount == 0) {
+    throw std::invalid_argument("RollbackBuffer needs at least one frame");
+  }
+  const size_t total = _frameCount * _bytesPerFrame;
+  _memory = std::make_unique<std::byte[]>(total + Alignment);
+  void* aligned = _memory.get();
+  size_t space = total + Alignment;
+  _frames = static_cast<std::byte*>(std::align(Alignment, total, aligned, space));
+
+  for (size_t i = 0; i < _frameCount; ++i) {
+    if (_bytesPerFrame < sizeof(FrameHeader)) {
+      throw std::invalid_argument("RollbackBuffer frames are too small");
+    }
+    new (_frames + i * _bytesPerFrame) FrameHeader{};
+  }
+}
+
+std::byte* RollbackBuffer::slot(uint32_t tick) const {
+  return _frames + (tick % _frameCount) * _bytesPerFrame;
+}
+
+const RollbackBuffer::FrameHeader* RollbackBuffer::find(uint32_t tick) const {
+  const auto* header = reinterpret_cast<const FrameHeader*>(slot(tick));
+  return header->valid && header->tick == tick ? header : nullptr;
+}
+
+bool RollbackBuffer::contains(uint32_t tick) const {
+  return find(tick) != nullptr;
+}
+
+size_t RollbackBuffer::frameBytes(uint32_t tick) const {
+  const FrameHeader* header = find(tick);
+  return header ? header->bytes : 0;
+}
+
+void RollbackBuffer::capture(World& world) {
+  if (world._storageMode != StorageMode::Sparse) {
+    throw std::runtime_error("Rollback is only available with sparse storage");
+  }
+  world.flushDestroyedEntities();
+
+  std::byte* frame = slot(world._tick);
+  auto* header = reinterpret_cast<FrameHeader*>(frame);
+  // A frame that fails halfway is dropped rather than left half written
+  header->valid = false;
+
+  FrameCursor cursor(frame, _bytesPerFrame);
+  cursor.take<FrameHeader>(1);
+
+  const EntityManager& entities = world._entityManager;
+  cursor.write(entities.generations());
+  cursor.write(entities.signatures());
+  cursor.write(entities.freeIndices());
+
+  uint32_t columnCount = 0;
+  for (ComponentId id = 0; id < MaxComponents; ++id) {
+    const IComponentStorage* storage = world._componentManager.rawStorage(id);
+    if (!storage) continue;
+    if (!storage->triviallyCopyable()) {
+      throw std::runtime_error("Rollback needs trivially copyable components, component " + std::to_string(id) +
+                               " is not");
+    }
+    auto* column = cursor.take<ColumnHeader>(1);
+    *column = ColumnHeader{id, static_cast<uint32_t>(storage->size()), storage->rowSize()};
+    cursor.write(storage->entities());
+    std::byte* rows = cursor.take(storage->size() * storage->rowSize(), Alignment);
+    if (storage->size() > 0) {
+      std::memcpy(rows, storage->rawData(), storage->size() * storage->rowSize());
+    }
+    ++columnCount;
+  }
+
+  uint32_t tagCount = 0;
+  for (TagId tag = 0; tag < world._tags.tagCount(); ++tag) {
+    const std::span<const uint64_t> bits = world._tags.bits(tag);
+    if (bits.empty()) continue;
+    *cursor.take<TagHeader>(1) = TagHeader{tag, static_cast<uint32_t>(bits.size())};
+    cursor.write(bits);
+    ++tagCount;
+  }
+
+  header->tick = world._tick;
+  header->entityCount = entities.capacity();
+  header->freeCount = static_cast<uint32_t>(entities.freeIndices().size());
+  header->columnCount = columnCount;
+  header->tagCount = tagCount;
+  header->bytes = cursor.offset();
+  header->valid = true;
+}
+
+bool RollbackBuffer::restore(World& world, uint32_t tick) const {
+  if (world._storageMode != StorageMode::Sparse) {
+    throw std::runtime_error("Rollback is only available with sparse storage");
+  }
+  const FrameHeader* header = find(tick);
+  if (!header) {
+    return false;
+  }
+
+  // The frame was laid out by capture, reading it back in the same order cannot overflow
+  FrameCursor cursor(slot(tick), _bytesPerFrame);
+  cursor.take<FrameHeader>(1);
+
+  const auto* generations = cursor.take<uint32_t>(header->entityCount);
+  const auto* signatures = cursor.take<ComponentSignature>(header->entityCount);
+  const auto* freeIndices = cursor.take<uint32_t>(header->freeCount);
+
+  world._pendingDestroy.clear();
+  world._entityManager.restore({generations, header->entityCount}, {freeIndices, header->freeCount},
+                               {signatures, header->entityCount});
+  world._tick = header->tick;
+  world._componentManager.setTick(header->tick);
+
+  // Storages registered after the capture are emptied
+  ComponentSignature restored;
+  for (uint32_t i = 0; i < header->columnCount; ++i) {
+    const auto* column = cursor.take<ColumnHeader>(1);
+    const auto* ids = cursor.take<EntityId>(column->count);
+    const std::byte* rows = cursor.take(column->count * column->rowSize, Alignment);
+    world._componentManager.rawStorage(column->component)->assignRaw({ids, column->count}, rows);
+    restored.set(column->component);
+  }
+  for (ComponentId id = 0; id < MaxComponents; ++id) {
+    IComponentStorage* storage = world._componentManager.rawStorage(id);
+    if (storage && !restored.test(id)) {
+      storage->clear();
+    }
+  }
+
+  const size_t currentTags = world._tags.tagCount();
+  TagId next = 0;
+  for (uint32_t i = 0; i < header->tagCount; ++i) {
+    const auto* entry = cursor.take<TagHeader>(1);
+    const auto* words = cursor.take<uint64_t>(entry->words);
+    // Tags captured without bits in between are cleared
+    for (; next < entry->tag; ++next) {
+      world._tags.assign(next, {});
+    }
+    world._tags.assign(entry->tag, {words, entry->words});
+    next = entry->tag + 1;
+  }
+  for (; next < currentTags; ++next) {
+    world._tags.assign(next, {});
+  }
+
+  world.rebuildMembership();
+  return true;
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+
+class World;
+
+//
+//  Ring of per-frame World states for rollback and resimulation
+//
+//  capture() copies the entity generations, signatures and free list, every component
+//  column and every tag bitset of the world into the slot of its current tick. The
+//  slots are carved out of one block allocated up front, capturing never allocates and
+//  throws if a frame outgrows its slot. restore() copies a captured frame back over
+//  the world, which does not allocate either once the world's arrays are as large as
+//  the restored state.
+//
+//  Only worlds using StorageMode::Sparse whose components are all trivially copyable
+//  can be captured. Commands that have not been flushed are not part of a frame.
+//
+//      RollbackBuffer rollback(8, 4 << 20);
+//      rollback.capture(world);                 // every frame, before advanceFrame()
+//      rollback.restore(world, confirmedTick);  // then resimulate up to the present
+//
+class RollbackBuffer {
+ public:
+  RollbackBuffer(size_t frameCount, size_t bytesPerFrame);
+
+  RollbackBuffer(const RollbackBuffer&) = delete;
+  RollbackBuffer& operator=(const RollbackBuffer&) = delete;
+
+  // Stores the world under its current tick, replacing the oldest frame
+  void capture(World& world);
+  // Returns false if the tick has not been captured or was overwritten
+  bool restore(World& world, uint32_t tick) const;
+  bool contains(uint32_t tick) const;
+
+  size_t frameCount() const { return _frameCount; }
+  size_t bytesPerFrame() const { return _bytesPerFrame; }
+  // Bytes used by the captured tick, 0 if it is not held
+  size_t frameBytes(uint32_t tick) const;
+
+ private:
+  static constexpr size_t Alignment = 64;
+
+  struct FrameHeader {
+    bool valid = false;
+    uint32_t tick = 0;
+    uint32_t entityCount = 0;
+    uint32_t freeCount = 0;
+    uint32_t columnCount = 0;
+    uint32_t tagCount = 0;
+    size_t bytes = 0;
+  };
+
+  struct ColumnHeader {
+    uint32_t component = 0;
+    uint32_t count = 0;
+    size_t rowSize = 0;
+  };
+
+  struct TagHeader {
+    uint32_t tag = 0;
+    uint32_t words = 0;
+  };
+
+  size_t _frameCount;
+  size_t _bytesPerFrame;
+  std::unique_ptr<std::byte[]> _memory;
+  std::byte* _frames = nullptr;
+
+  std::byte* slot(uint32_t tick) const;
+  const FrameHeader* find(uint32_t tick) const;
+};
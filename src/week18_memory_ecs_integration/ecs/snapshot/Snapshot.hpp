@@ -0,0 +1,112 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <span>
+#include <stdexcept>
+#include <string>
+
+//
+//  Binary World snapshot, version 1
+//
+//    SnapshotHeader
+//    uint32_t generations[entityCount]
+//    uint32_t freeIndices[freeCount]
+//    sectionCount times SnapshotSection, its name, then
+//      Component:  EntityId entities[count], count raw component rows
+//      Tag:        uint64_t bits[count]
+//
+//  Every block starts on a SnapshotAlignment boundary, so component columns can be
+//  copied straight out of a mapping of the file. Values are in host byte order, a
+//  snapshot is only meant to be loaded by the build that wrote it.
+//
+inline constexpr uint32_t SnapshotMagic = 0x31534345;  // "ECS1"
+inline constexpr uint32_t SnapshotVersion = 1;
+inline constexpr size_t SnapshotAlignment = 64;
+
+struct SnapshotHeader {
+  uint32_t magic = SnapshotMagic;
+  uint32_t version = SnapshotVersion;
+  uint32_t tick = 0;
+  uint32_t entityCount = 0;
+  uint32_t freeCount = 0;
+  uint32_t sectionCount = 0;
+};
+
+enum class SnapshotSectionKind : uint32_t { Component = 1, Tag = 2 };
+
+struct SnapshotSection {
+  SnapshotSectionKind kind = SnapshotSectionKind::Component;
+  uint32_t nameLength = 0;
+  uint32_t size = 0;
+  uint32_t alignment = 0;
+  uint64_t count = 0;
+};
+
+// Writes aligned blocks to a file
+class SnapshotWriter {
+ public:
+  explicit SnapshotWriter(const std::string& path) : _out(path, std::ios::binary | std::ios::trunc) {
+    if (!_out) {
+      throw std::runtime_error("Could not create " + path);
+    }
+  }
+
+  void write(const void* data, size_t bytes) {
+    align();
+    _out.write(static_cast<const char*>(data), static_cast<std::streamsize>(bytes));
+    _offset += bytes;
+  }
+
+  template <typename T>
+  void write(std::span<const T> values) {
+    write(values.data(), values.size_bytes());
+  }
+
+  void finish() {
+    _out.flush();
+    if (!_out) {
+      throw std::runtime_error("Failed writing snapshot");
+    }
+  }
+
+ private:
+  std::ofstream _out;
+  size_t _offset = 0;
+
+  void align() {
+    static constexpr char zeros[SnapshotAlignment] = {};
+    const size_t padding = (SnapshotAlignment - _offset % SnapshotAlignment) % SnapshotAlignment;
+    _out.write(zeros, static_cast<std::streamsize>(padding));
+    _offset += padding;
+  }
+};
+
+// Bounds checked reads of aligned blocks out of a mapped snapshot
+class SnapshotReader {
+ public:
+  explicit SnapshotReader(std::span<const std::byte> bytes) : _bytes(bytes) {}
+
+  const std::byte* read(size_t bytes) {
+    _offset = (_offset + SnapshotAlignment - 1) / SnapshotAlignment * SnapshotAlignment;
+    if (_offset > _bytes.size() || bytes > _bytes.size() - _offset) {
+      throw std::runtime_error("Snapshot is truncated");
+    }
+    const std::byte* data = _bytes.data() + _offset;
+    _offset += bytes;
+    return data;
+  }
+
+  template <typename T>
+  std::span<const T> read(size_t count) {
+    if (count > SIZE_MAX / sizeof(T)) {
+      throw std::runtime_error("Snapshot is corrupted");
+    }
+    return {reinterpret_cast<const T*>(read(count * sizeof(T))), count};
+  }
+
+ private:
+  std::span<const std::byte> _bytes;
+  size_t _offset = 0;
+};
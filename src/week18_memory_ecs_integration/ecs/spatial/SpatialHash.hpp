@@ -0,0 +1,218 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <concepts>
+#include <cstdint>
+#include <limits>
+#include <span>
+#include <stdexcept>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "../component/ComponentConcepts.hpp"
+#include "../component/ComponentStorage.hpp"
+#include "../entity/EntityId.hpp"
+#include "../query/Query.hpp"
+
+template <typename T>
+concept PlanarPosition = ComponentType<T> && requires(const T& position) {
+  { position.x } -> std::convertible_to<float>;
+  { position.y } -> std::convertible_to<float>;
+};
+
+//
+//  Uniform grid over the x/y of a position component, hashed by cell so that only
+//  occupied cells cost memory. Every cell keeps its entities together with a copy of
+//  their position, so a query only touches the cells overlapping its bounds.
+//
+//  The World keeps membership in sync like it does for queries. Movement is picked up
+//  by update(), which re-buckets only the rows whose change tick is newer than the
+//  last update. Queries see positions as of the last update.
+//
+template <PlanarPosition T>
+class SpatialHash : public IQuery {
+  static constexpr uint32_t npos = std::numeric_limits<uint32_t>::max();
+
+ public:
+  SpatialHash(ComponentStorage<T>& storage, float cellSize)
+      : _storage(storage), _cellSize(cellSize), _inverseCellSize(1.0f / cellSize) {
+    if (!(cellSize > 0.0f)) {
+      throw std::runtime_error("Spatial hash cell size has to be positive");
+    }
+    _mask.set(T::typeId());
+    rebuild();
+  }
+
+  void onAdded(EntityId entity) override {
+    if (const T* position = std::as_const(_storage).get(entity)) {
+      place(entity, position->x, position->y);
+    }
+  }
+
+  void onRemoving(EntityId entity) override {
+    erase(entity);
+  }
+
+  void rebuild() override {
+    _cells.clear();
+    _slots.clear();
+    _size = 0;
+    const T* rows = std::as_const(_storage).data();
+    const std::span<const EntityId> ids = _storage.entities();
+    for (size_t row = 0; row < ids.size(); ++row) {
+      place(ids[row], rows[row].x, rows[row].y);
+    }
+    _since = _storage.tick();
+  }
+
+  // Refreshes the entities whose T was handed out mutably since the last update and
+  // returns how many of them changed cell. Call at a sync point, not while systems
+  // are querying the hash.
+  size_t update() {
+    const T* rows = std::as_const(_storage).data();
+    const std::span<const EntityId> ids = _storage.entities();
+    size_t moved = 0;
+    for (uint32_t row = 0; row < ids.size(); ++row) {
+      // Membership only changes through the hooks, rows of retired entities stay out
+      if (_storage.changedTick(row) >= _since && contains(ids[row])) {
+        moved += place(ids[row], rows[row].x, rows[row].y);
+      }
+    }
+    _since = _storage.tick();
+    return moved;
+  }
+
+  // Entities within radius of (x, y). Results are written to out, the span views it.
+  std::span<const EntityId> queryRadius(float x, float y, float radius, std::vector<EntityId>& out) const {
+    out.clear();
+    const float radiusSquared = radius * radius;
+    forEachCell(x - radius, y - radius, x + radius, y + radius, [&](const std::vector<Entry>& entries) {
+      for (const Entry& entry : entries) {
+        const float dx = entry.x - x;
+        const float dy = entry.y - y;
+        if (dx * dx + dy * dy <= radiusSquared) {
+          out.push_back(entry.id);
+        }
+      }
+    });
+    return out;
+  }
+
+  // Entities inside the box, bounds included
+  std::span<const EntityId> queryBox(float minX, float minY, float maxX, float maxY, std::vector<EntityId>& out) const {
+    out.clear();
+    forEachCell(minX, minY, maxX, maxY, [&](const std::vector<Entry>& entries) {
+      for (const Entry& entry : entries) {
+        if (entry.x >= minX && entry.x <= maxX && entry.y >= minY && entry.y <= maxY) {
+          out.push_back(entry.id);
+        }
+      }
+    });
+    return out;
+  }
+
+  bool contains(EntityId entity) const {
+    if (entity.index >= _slots.size() || _slots[entity.index].position == npos) return false;
+    const Slot& slot = _slots[entity.index];
+    return _cells.find(slot.cell)->second[slot.position].id == entity;
+  }
+
+  size_t size() const { return _size; }
+  size_t cellCount() const { return _cells.size(); }
+  float cellSize() const { return _cellSize; }
+
+ private:
+  struct Entry {
+    EntityId id;
+    float x;
+    float y;
+  };
+
+  // Where an entity index sits, npos when it is not in the hash
+  struct Slot {
+    uint64_t cell = 0;
+    uint32_t position = npos;
+  };
+
+  ComponentStorage<T>& _storage;
+  float _cellSize;
+  float _inverseCellSize;
+  uint32_t _since = 0;
+  size_t _size = 0;
+  std::unordered_map<uint64_t, std::vector<Entry>> _cells;
+  std::vector<Slot> _slots;
+
+  int32_t cellOf(float coordinate) const {
+    constexpr float limit = static_cast<float>(1 << 30);
+    return static_cast<int32_t>(std::clamp(std::floor(coordinate * _inverseCellSize), -limit, limit));
+  }
+
+  static uint64_t cellKey(int32_t x, int32_t y) {
+    return (uint64_t{static_cast<uint32_t>(x)} << 32) | static_cast<uint32_t>(y);
+  }
+
+  // Returns whether the entity changed cell
+  bool place(EntityId entity, float x, float y) {
+    const uint64_t cell = cellKey(cellOf(x), cellOf(y));
+    if (entity.index >= _slots.size()) {
+      _slots.resize(entity.index + 1);
+    }
+    Slot& slot = _slots[entity.index];
+    if (slot.position != npos) {
+      if (slot.cell == cell) {
+        _cells.find(cell)->second[slot.position] = Entry{entity, x, y};
+        return false;
+      }
+      erase(entity);
+    }
+
+    std::vector<Entry>& entries = _cells[cell];
+    slot = Slot{cell, static_cast<uint32_t>(entries.size())};
+    entries.push_back(Entry{entity, x, y});
+    ++_size;
+    return true;
+  }
+
+  void erase(EntityId entity) {
+    if (entity.index >= _slots.size() || _slots[entity.index].position == npos) return;
+    Slot& slot = _slots[entity.index];
+
+    auto it = _cells.find(slot.cell);
+    std::vector<Entry>& entries = it->second;
+    entries[slot.position] = entries.back();
+    _slots[entries[slot.position].id.index].position = slot.position;
+    entries.pop_back();
+    if (entries.empty()) {
+      _cells.erase(it);
+    }
+    slot.position = npos;
+    --_size;
+  }
+
+  // Visits every occupied cell overlapping the bounds. Falls back to walking all
+  // occupied cells when the bounds cover more cells than are occupied.
+  template <typename Fn>
+  void forEachCell(float minX, float minY, float maxX, float maxY, Fn&& fn) const {
+    const int32_t x0 = cellOf(minX), x1 = cellOf(maxX);
+    const int32_t y0 = cellOf(minY), y1 = cellOf(maxY);
+    if (x1 < x0 || y1 < y0) return;
+
+    const int64_t covered = (int64_t{x1} - x0 + 1) * (int64_t{y1} - y0 + 1);
+    if (covered > static_cast<int64_t>(_cells.size())) {
+      for (const auto& [key, entries] : _cells) {
+        fn(entries);
+      }
+      return;
+    }
+    for (int32_t y = y0; y <= y1; ++y) {
+      for (int32_t x = x0; x <= x1; ++x) {
+        auto it = _cells.find(cellKey(x, y));
+        if (it != _cells.end()) {
+          fn(it->second);
+        }
+      }
+    }
+  }
+};
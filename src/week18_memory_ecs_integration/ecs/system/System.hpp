@@ -1,11 +1,31 @@
 #pragma once
 
+#include <cstddef>
+
 class World;
 
+// Half-open range of a system's work items
+struct SystemRange {
+  size_t begin;
+  size_t end;
+};
+
 class System {
  public:
   virtual ~System() = default;
+  // Called once by World::registerSystem on the registering thread. Systems resolve
+  // their queries and groups here and keep them, looking them up is a scan that may
+  // create them, which must not happen while systems run in parallel.
+  virtual void attach(World&) {}
   virtual void update(World& world, float dt) = 0;
   virtual const char* name() const { return "UNNAMED_SYSTEM"; }
+
+  // Systems whose work splits into independent items can be fanned out over several
+  // tasks by the scheduler. costHint() is asked once per frame for the number of items,
+  // then updateRange() runs concurrently on disjoint ranges of [0, costHint()).
+  virtual bool supportsRange() const { return false; }
+  virtual size_t costHint(World&) { return 0; }
+  virtual void updateRange(World&, float, SystemRange) {}
+
   bool enabled = true;
-};
\ No newline at end of file
+};
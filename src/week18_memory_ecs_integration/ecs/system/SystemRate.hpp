@@ -0,0 +1,23 @@
+#pragma once
+
+#include <cstdint>
+
+//
+//  How often a system runs, declared through SystemTraits<T>::Rate
+//
+//    everyFrame()   once per frame with the frame's dt (default)
+//    fixed(hz)      zero or more times per frame with dt = 1 / hz, driven by an
+//                   accumulator so that the number of steps matches simulated time
+//    interval(hz)   at most once per frame, once 1 / hz has elapsed since its last
+//                   run, with dt = the time elapsed since then
+//
+struct SystemRate {
+  enum class Mode : uint8_t { EveryFrame, Fixed, Interval };
+
+  Mode mode = Mode::EveryFrame;
+  float period = 0.0f;
+
+  static constexpr SystemRate everyFrame() { return SystemRate{Mode::EveryFrame, 0.0f}; }
+  static constexpr SystemRate fixed(float hz) { return SystemRate{Mode::Fixed, 1.0f / hz}; }
+  static constexpr SystemRate interval(float hz) { return SystemRate{Mode::Interval, 1.0f / hz}; }
+};
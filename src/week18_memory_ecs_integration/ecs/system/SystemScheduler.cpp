@@ -1,25 +1,86 @@
 #include "SystemScheduler.hpp"
 
+#include <cmath>
+#include <set>
+#include <stdexcept>
+#include <string>
+
 #include "../../tasks/TaskId.hpp"
 #include "../World.hpp"
 
 void SystemScheduler::update(World& world, float dt) {
-  for (auto& system : _systems) {
-    if (!system->enabled) {
+  advanceClocks(dt);
+  for (SystemId sid = 0; sid < _systems.size(); ++sid) {
+    if (_systems[sid]->enabled) {
+      runSteps(world, sid);
+    }
+  }
+}
+
+void SystemScheduler::advanceClocks(float dt) {
+  for (SystemId sid = 0; sid < _systems.size(); ++sid) {
+    const SystemRate& rate = _rates[sid];
+    if (!_systems[sid]->enabled) {
+      _steps[sid] = 0;
       continue;
     }
-    system->update(world, dt);
+
+    switch (rate.mode) {
+      case SystemRate::Mode::EveryFrame:
+        _steps[sid] = 1;
+        _stepDt[sid] = dt;
+        break;
+      case SystemRate::Mode::Fixed: {
+        _accumulators[sid] += dt;
+        uint32_t steps = static_cast<uint32_t>(_accumulators[sid] / rate.period);
+        if (steps > MaxFixedSteps) {
+          steps = MaxFixedSteps;
+          _accumulators[sid] = std::fmod(_accumulators[sid], rate.period);
+        } else {
+          _accumulators[sid] -= static_cast<float>(steps) * rate.period;
+        }
+        _steps[sid] = steps;
+        _stepDt[sid] = rate.period;
+        break;
+      }
+      case SystemRate::Mode::Interval:
+        _accumulators[sid] += dt;
+        _sinceRun[sid] += dt;
+        _steps[sid] = _accumulators[sid] >= rate.period ? 1 : 0;
+        if (_steps[sid]) {
+          // Keep the overshoot so the average rate holds, a stall is not caught up
+          _accumulators[sid] = std::fmod(_accumulators[sid] - rate.period, rate.period);
+          _stepDt[sid] = _sinceRun[sid];
+          _sinceRun[sid] = 0.0f;
+        }
+        break;
+    }
+  }
+}
+
+void SystemScheduler::runSteps(World& world, SystemId sid) {
+  for (uint32_t step = 0; step < _steps[sid]; ++step) {
+    ProfileScope scope(ProfileCategory::System, _systems[sid]->name());
+    _systems[sid]->update(world, _stepDt[sid]);
   }
 }
 
 void SystemScheduler::clear() {
   _systems.clear();
   _tagProviders.clear();
+  _systemDependsOn.clear();
   _systemReads.clear();
   _systemWrites.clear();
-  _systemTypes.clear();
-  _systemJobMap.clear();
-  _dependencyResolvers.clear();
+  _rates.clear();
+  _accumulators.clear();
+  _steps.clear();
+  _stepDt.clear();
+  _sinceRun.clear();
+  _systemEntryTasks.clear();
+  _systemExitTasks.clear();
+  _graph->clear();
+  _compiledFor = nullptr;
+  _compiledEnabled.clear();
 }
 
 void SystemScheduler::disableSystem(System& system) {
@@ -40,32 +101,203 @@ void SystemScheduler::enableSystem(System& system) {
   }
 }
 
-void SystemScheduler::buildTaskGraph(TaskGraph& graph, World& world, float dt) {
-  _systemJobMap.clear();
+TaskGraph& SystemScheduler::frameGraph(World& world, float dt) {
+  if (needsCompile(world)) {
+    compile(world);
+  }
+  advanceClocks(dt);
+  _graph->reset();
+  return *_graph;
+}
+
+const TaskGraph& SystemScheduler::compiledGraph(World& world) {
+  if (needsCompile(world)) {
+    compile(world);
+  }
+  return *_graph;
+}
 
+bool SystemScheduler::needsCompile(const World& world) const {
+  // Systems can be toggled through their enabled flag directly, so compare the flags
+  if (_compiledFor != &world || _compiledParallelism != _parallelism || _compiledEnabled.size() != _systems.size()) {
+    return true;
+  }
   for (SystemId sid = 0; sid < _systems.size(); ++sid) {
-    if (!_systems[sid]->enabled) {
-      continue;
+    if (_compiledEnabled[sid] != _systems[sid]->enabled) {
+      return true;
     }
+  }
+  return false;
+}
+
+void SystemScheduler::compile(World& world) {
+  _graph->clear();
+  _systemEntryTasks.clear();
+  _systemExitTasks.clear();
+  _rangeItems.assign(_systems.size(), 0);
+
+  const std::vector<SystemId> order = executionOrder();
+  for (SystemId sid : order) {
+    addSystemTasks(world, sid);
+  }
 
-    TaskId tid = graph.addTask([this, sid, &world, dt]() {
-      _systems[sid]->update(world, dt);
-    });
-    _systemJobMap[sid] = tid;
+  for (auto [dependent, prerequisite] : dependencyEdges(order)) {
+    _graph->addDependency(_systemEntryTasks.at(dependent), _systemExitTasks.at(prerequisite));
   }
 
+  _compiledFor = &world;
+  _compiledParallelism = _parallelism;
+  _compiledEnabled.clear();
+  for (const auto& system : _systems) {
+    _compiledEnabled.push_back(system->enabled);
+  }
+}
+
+void SystemScheduler::addSystemTasks(World& world, SystemId sid) {
+  // Deferred commands play back by sort key, the system id in the upper bits and the
+  // chunk in the lower ones keep the playback order independent of the workers.
+  // Fixed rate systems may step several times a frame and are never fanned out.
+  if (!_systems[sid]->supportsRange() || _parallelism <= 1 || _rates[sid].mode == SystemRate::Mode::Fixed) {
+    TaskId tid = _graph->addTask([this, sid, &world]() {
+      world.commands().setSortKey(sid << 16);
+      runSteps(world, sid);
+    }, _systems[sid]->name());
+    _systemEntryTasks[sid] = tid;
+    _systemExitTasks[sid] = tid;
+    return;
+  }
+
+  const char* name = _systems[sid]->name();
+  TaskId fork = _graph->addTask([this, sid, &world]() {
+    _rangeItems[sid] = _steps[sid] > 0 ? _systems[sid]->costHint(world) : 0;
+  }, name);
+  TaskId join = _graph->addTask([]() {}, name);
+
+  const size_t maxChunks = _parallelism;
+  for (size_t chunk = 0; chunk < maxChunks; ++chunk) {
+    TaskId tid = _graph->addTask([this, sid, chunk, maxChunks, &world]() {
+      const size_t items = _rangeItems[sid];
+      const size_t chunks = std::clamp<size_t>(items / MinRangeItems, 1, maxChunks);
+      if (_steps[sid] == 0 || chunk >= chunks) return;
+      world.commands().setSortKey((sid << 16) | static_cast<uint32_t>(chunk));
+      ProfileScope scope(ProfileCategory::System, _systems[sid]->name());
+      _systems[sid]->updateRange(world, _stepDt[sid], SystemRange{items * chunk / chunks, items * (chunk + 1) / chunks});
+    }, name);
+    _graph->addDependency(tid, fork);
+    _graph->addDependency(join, tid);
+  }
+  _systemEntryTasks[sid] = fork;
+  _systemExitTasks[sid] = join;
+}
+
+void SystemScheduler::setParallelism(size_t chunks) {
+  if (chunks == 0 || chunks > 0xFFFF) {
+    throw std::runtime_error("System parallelism has to be in [1, 65535]");
+  }
+  _parallelism = chunks;
+}
+
+std::vector<SystemId> SystemScheduler::executionOrder() const {
+  // Kahn's algorithm over the DependsOn edges, always taking the lowest ready id
+  std::vector<std::vector<SystemId>> consumers(_systems.size());
+  std::vector<size_t> pending(_systems.size(), 0);
+  size_t enabled = 0;
   for (SystemId sid = 0; sid < _systems.size(); ++sid) {
-    if (!_systems[sid]->enabled) {
-      continue;
+    if (!_systems[sid]->enabled) continue;
+    ++enabled;
+    for (const std::type_index& tag : typesOf(_systemDependsOn, sid)) {
+      auto it = _tagProviders.find(tag);
+      if (it == _tagProviders.end() || it->second == sid || !_systems[it->second]->enabled) continue;
+      consumers[it->second].push_back(sid);
+      ++pending[sid];
     }
-    auto it = _systemTypes.find(sid);
-    if (it == _systemTypes.end()) {
-      continue;
+  }
+
+  std::set<SystemId> ready;
+  for (SystemId sid = 0; sid < _systems.size(); ++sid) {
+    if (_systems[sid]->enabled && pending[sid] == 0) {
+      ready.insert(sid);
+    }
+  }
+
+  std::vector<SystemId> order;
+  while (!ready.empty()) {
+    const SystemId sid = *ready.begin();
+    ready.erase(ready.begin());
+    order.push_back(sid);
+    for (SystemId consumer : consumers[sid]) {
+      if (--pending[consumer] == 0) {
+        ready.insert(consumer);
+      }
     }
-    std::type_index systemType = it->second;
-    auto resolverIt = _dependencyResolvers.find(systemType);
-    if (resolverIt != _dependencyResolvers.end()) {
-      resolverIt->second(*this, sid, graph);
+  }
+
+  if (order.size() != enabled) {
+    for (SystemId sid = 0; sid < _systems.size(); ++sid) {
+      if (_systems[sid]->enabled && pending[sid] != 0) {
+        throw std::runtime_error(std::string("Cyclic DependsOn between systems, involving ") + _systems[sid]->name());
+      }
     }
   }
-}
\ No newline at end of file
+  return order;
+}
+
+std::vector<std::pair<SystemId, SystemId>> SystemScheduler::dependencyEdges(const std::vector<SystemId>& order) const {
+  std::vector<std::pair<SystemId, SystemId>> edges;
+  std::vector<SystemId> prerequisites;
+  auto require = [&](SystemId prerequisite) {
+    if (std::find(prerequisites.begin(), prerequisites.end(), prerequisite) == prerequisites.end()) {
+      prerequisites.push_back(prerequisite);
+    }
+  };
+
+  // Per component: the last system writing it and the systems reading it since
+  std::unordered_map<std::type_index, SystemId> lastWriter;
+  std::unordered_map<std::type_index, std::vector<SystemId>> readers;
+
+  for (SystemId sid : order) {
+    prerequisites.clear();
+
+    for (const std::type_index& tag : typesOf(_systemDependsOn, sid)) {
+      auto it = _tagProviders.find(tag);
+      if (it != _tagProviders.end() && it->second != sid && _systems[it->second]->enabled) {
+        require(it->second);
+      }
+    }
+    for (const std::type_index& component : typesOf(_systemReads, sid)) {
+      if (auto it = lastWriter.find(component); it != lastWriter.end()) {
+        require(it->second);
+      }
+    }
+    for (const std::type_index& component : typesOf(_systemWrites, sid)) {
+      if (auto it = lastWriter.find(component); it != lastWriter.end()) {
+        require(it->second);
+      }
+      for (SystemId reader : readers[component]) {
+        require(reader);
+      }
+    }
+
+    for (const std::type_index& component : typesOf(_systemReads, sid)) {
+      readers[component].push_back(sid);
+    }
+    for (const std::type_index& component : typesOf(_systemWrites, sid)) {
+      lastWriter.insert_or_assign(component, sid);
+      readers[component].clear();
+    }
+
+    for (SystemId prerequisite : prerequisites) {
+      if (prerequisite != sid) {
+        edges.emplace_back(sid, prerequisite);
+      }
+    }
+  }
+  return edges;
+}
+
+const std::vector<std::type_index>& SystemScheduler::typesOf(
+    const std::unordered_map<SystemId, std::vector<std::type_index>>& map, SystemId id) {
+  static const std::vector<std::type_index> none;
+  auto it = map.find(id);
+  return it != map.end() ? it->second : none;
+}
@@ -5,6 +5,7 @@
 #include <memory>
 #include <typeindex>
 #include <unordered_map>
+#include <utility>
 #include <vector>
 
 #include "../../tasks/TaskGraph.hpp"
@@ -14,6 +15,27 @@
 
 class World;
 
+//
+//  Turns the registered systems into one task per system and wires the edges between
+//  them from their SystemTraits:
+//
+//    DependsOn/Provides  a system runs after the providers of the tags it depends on
+//    Reads/Writes        two systems touching the same component, at least one of them
+//                        writing it, run one after the other
+//
+//  Conflicting systems keep their registration order unless DependsOn asks otherwise,
+//  everything without a conflict is free to run concurrently.
+//
+//  Systems declaring a SystemRate keep their task in the graph every frame, the task
+//  runs the system as many times as its rate asks for, possibly none.
+//
+//  Systems that support ranges are fanned out into a fork task that reads their cost
+//  hint, up to parallelism() chunk tasks and a join task. Edges to the system end at
+//  the fork, edges from it start at the join.
+//
+//  The graph is compiled once and re-armed every frame. It is only rebuilt after
+//  systems were registered, enabled or disabled, or the parallelism changed.
+//
 class SystemScheduler {
  public:
   SystemScheduler() = default;
@@ -24,33 +46,86 @@ class SystemScheduler {
   SystemScheduler& operator=(SystemScheduler&&) noexcept = default;
 
   template <typename T, typename... Args>
-  void registerSystem(Args&&... args);
+  T& registerSystem(Args&&... args);
 
+  // Runs every enabled system on the calling thread, honoring their rates
   void update(World& world, float dt);
   void clear();
   void disableSystem(System& system);
   void enableSystem(System& system);
 
-  void buildTaskGraph(TaskGraph& graph, World& world, float dt);
+  // The frame's task graph, ready for JobSystem::execute. The previous frame's graph
+  // has to have completed.
+  TaskGraph& frameGraph(World& world, float dt);
+  // The compiled graph for inspection, the rate clocks are left alone
+  const TaskGraph& compiledGraph(World& world);
+
+  // Most chunk tasks a range-capable system is split into, 1 keeps every system whole
+  void setParallelism(size_t chunks);
+  size_t parallelism() const { return _parallelism; }
+
+  // Fewest items a chunk is given, smaller workloads use fewer chunks
+  static constexpr size_t MinRangeItems = 256;
+  // Most steps a fixed rate system catches up in one frame, older backlog is dropped
+  static constexpr uint32_t MaxFixedSteps = 8;
 
  private:
   std::vector<std::shared_ptr<System>> _systems;
   std::unordered_map<std::type_index, SystemId> _tagProviders;
+  std::unordered_map<SystemId, std::vector<std::type_index>> _systemDependsOn;
   std::unordered_map<SystemId, std::vector<std::type_index>> _systemReads;
   std::unordered_map<SystemId, std::vector<std::type_index>> _systemWrites;
-  std::unordered_map<SystemId, std::type_index> _systemTypes;
-  std::unordered_map<SystemId, TaskId> _systemJobMap;
-  std::unordered_map<std::type_index, std::function<void(SystemScheduler&, SystemId, TaskGraph&)>> _dependencyResolvers;
+  // First and last task of every enabled system, the same one unless it is fanned out
+  std::unordered_map<SystemId, TaskId> _systemEntryTasks;
+  std::unordered_map<SystemId, TaskId> _systemExitTasks;
+
+  // Compiled graph, behind a pointer since its tasks point back into it
+  std::unique_ptr<TaskGraph> _graph = std::make_unique<TaskGraph>();
+  World* _compiledFor = nullptr;
+  std::vector<bool> _compiledEnabled;
+  size_t _compiledParallelism = 0;
+  size_t _parallelism = 1;
+
+  // Per system rate and this frame's schedule
+  std::vector<SystemRate> _rates;
+  std::vector<float> _accumulators;
+  std::vector<uint32_t> _steps;
+  std::vector<float> _stepDt;
+  // Time since an interval system last ran, passed as its dt
+  std::vector<float> _sinceRun;
+  // Cost hints of the current frame, written by the fork tasks
+  std::vector<size_t> _rangeItems;
+
+  bool needsCompile(const World& world) const;
+  void compile(World& world);
+  void addSystemTasks(World& world, SystemId sid);
+  // Advances every rate's clock by dt and decides the steps of this frame
+  void advanceClocks(float dt);
+  void runSteps(World& world, SystemId sid);
+
+  // Enabled systems in registration order, moved behind the providers they depend on
+  std::vector<SystemId> executionOrder() const;
+  // (dependent, prerequisite) pairs over the execution order
+  std::vector<std::pair<SystemId, SystemId>> dependencyEdges(const std::vector<SystemId>& order) const;
+
+  static const std::vector<std::type_index>& typesOf(const std::unordered_map<SystemId, std::vector<std::type_index>>& map, SystemId id);
 };
 
 template <typename T, typename... Args>
-void SystemScheduler::registerSystem(Args&&... args) {
+T& SystemScheduler::registerSystem(Args&&... args) {
   static_assert(std::is_base_of_v<System, T>, "T must derive from System");
 
   auto system = std::make_shared<T>(std::forward<Args>(args)...);
+  T& result = *system;
   SystemId id = static_cast<SystemId>(_systems.size());
-  std::type_index systemType = std::type_index(typeid(T));
-  _systemTypes.emplace(id, std::type_index(typeid(T)));
+
+  constexpr SystemRate rate = systemRateOf<T>();
+  static_assert(rate.mode == SystemRate::Mode::EveryFrame || rate.period > 0.0f, "System rates need a positive frequency");
+  _rates.push_back(rate);
+  _accumulators.push_back(0.0f);
+  _steps.push_back(0);
+  _stepDt.push_back(0.0f);
+  _sinceRun.push_back(0.0f);
 
   // Register provided tags
   TypeListForEach<typename SystemTraits<T>::Provides>::apply(
@@ -59,6 +134,12 @@ void SystemScheduler::registerSystem(Args&&... args) {
         _tagProviders[tagIndex] = id;
       });
 
+  // Register required tags
+  TypeListForEach<typename SystemTraits<T>::DependsOn>::apply(
+      [&]<typename Tag>() {
+        _systemDependsOn[id].push_back(std::type_index(typeid(Tag)));
+      });
+
   // Register component reads
   TypeListForEach<typename SystemTraits<T>::Reads>::apply(
       [&]<typename Component>() {
@@ -71,19 +152,6 @@ void SystemScheduler::registerSystem(Args&&... args) {
         _systemWrites[id].push_back(std::type_index(typeid(Component)));
       });
 
-  // Register dependency resolver for this system type (only once per type)
-  if (_dependencyResolvers.find(systemType) == _dependencyResolvers.end()) {
-    _dependencyResolvers[systemType] = [](SystemScheduler& scheduler, SystemId sid, TaskGraph& graph) {
-      TypeListForEach<typename SystemTraits<T>::DependsOn>::apply(
-          [&]<typename Tag>() {
-            auto it = scheduler._tagProviders.find(std::type_index(typeid(Tag)));
-            if (it != scheduler._tagProviders.end()) {
-              SystemId providerSid = it->second;
-              graph.addDependency(scheduler._systemJobMap[providerSid], scheduler._systemJobMap[sid]);
-            }
-          });
-    };
-  }
-
   _systems.emplace_back(std::move(system));
-}
\ No newline at end of file
+  return result;
+}
@@ -1,5 +1,6 @@
 #pragma once
 
+#include "SystemRate.hpp"
 #include "TypeList.hpp"
 
 template <typename T>
@@ -8,4 +9,14 @@ struct SystemTraits {
   using Provides = EmptyList;
   using Reads = EmptyList;
   using Writes = EmptyList;
-};
\ No newline at end of file
+};
+
+// SystemTraits<T>::Rate is optional, systems without one run every frame
+template <typename T>
+constexpr SystemRate systemRateOf() {
+  if constexpr (requires { SystemTraits<T>::Rate; }) {
+    return SystemTraits<T>::Rate;
+  } else {
+    return SystemRate::everyFrame();
+  }
+}
@@ -1,5 +1,743 @@
+#include <chrono>
+#include <filesystem>
+#include <fstream>
 #include <iostream>
+#include <vector>
+
+#include "demo.hpp"
+#include "ecs/World.hpp"
+#include "ecs/hierarchy/TransformSystem.hpp"
+#include "ecs/scene/SceneLoader.hpp"
+#include "ecs/snapshot/RollbackBuffer.hpp"
+#include "memory/AllocatorTagRegistry.hpp"
+#include "tasks/JobSystem.hpp"
+#include "tasks/Profiler.hpp"
+#include "tasks/TaskGraph.hpp"
+
+void registerDemoComponents(World& world) {
+  world.registerComponent<Position>([](World& w, EntityId id, const nlohmann::json& json) {
+    w.addComponent<Position>(id, json.at("x").get<float>(), json.at("y").get<float>());
+  });
+  world.registerComponent<Velocity>([](World& w, EntityId id, const nlohmann::json& json) {
+    w.addComponent<Velocity>(id, json.at("dx").get<float>(), json.at("dy").get<float>());
+  });
+  world.registerComponent<Acceleration>([](World& w, EntityId id, const nlohmann::json& json) {
+    w.addComponent<Acceleration>(id, json.at("ax").get<float>(), json.at("ay").get<float>());
+  });
+  world.registerComponent<Health>([](World& w, EntityId id, const nlohmann::json& json) {
+    w.addComponent<Health>(id, json.at("current").get<float>());
+  });
+  world.registerComponent<RenderState>([](World& w, EntityId id, const nlohmann::json& json) {
+    w.addComponent<RenderState>(id, json.at("visible").get<bool>());
+  });
+}
+
+void demo_1_parallel_systems() {
+  JobSystem jobs;
+  World world;
+
+  registerDemoComponents(world);
+
+  // Groups sort their storages, declare them and queries before systems run in parallel
+  world.group<Position, Velocity>();
+  world.group<Position, Velocity, Acceleration>();
+  world.query<const Position, Health>();
+
+  world.registerSystem<InputSystem>();
+  world.registerSystem<AccelerationSystem>();
+  world.registerSystem<PhysicsSystem>();
+  world.registerSystem<RenderSystem>();
+  world.registerSystem<DamageSystem>();
+  world.setSystemParallelism(jobs.workerCount());
+
+  for (int i = 0; i < 10; ++i) {
+    EntityId id = world.createEntity();
+    world.addComponent<Position>(id, float(i), float(i));
+    world.addComponent<Velocity>(id, 1.0f, 0.5f);
+    world.addComponent<Acceleration>(id, 0.2f, 0.1f);
+    world.addComponent<Health>(id, 100.0f);
+    world.addComponent<RenderState>(id, true);
+  }
+
+  for (int frame = 0; frame < 5; ++frame) {
+    std::cout << "Frame " << frame << ":\n";
+
+    world.advanceFrame();
+    jobs.beginFrame();
+    jobs.execute(world.executionGraph(1.0f));
+    world.flushCommands();
+    jobs.endFrame();
+
+    for (auto [id, pos, vel, acc, health, rs] : world.view<Position, Velocity, Acceleration, Health, RenderState>()) {
+      std::cout << "Entity " << id.index
+                << " => Pos(" << pos->x << ", " << pos->y << ")"
+                << " Vel(" << vel->dx << ", " << vel->dy << ")"
+                << " Acc(" << acc->ax << ", " << acc->ay << ")"
+                << " Health: " << health->current
+                << " Visible: " << (rs->visible ? "true" : "false") << "\n";
+    }
+  }
+}
+
+void benchmark_storage_mode(StorageMode mode, const char* label) {
+  using namespace std::chrono;
+
+  constexpr int entityCount = 200'000;
+  World world(mode);
+  registerDemoComponents(world);
+
+  for (int i = 0; i < entityCount; ++i) {
+    EntityId id = world.createEntity();
+    world.addComponent<Position>(id, float(i), float(i));
+    world.addComponent<Velocity>(id, 1.0f, 0.5f);
+    if (i % 2 == 0) {
+      world.addComponent<Acceleration>(id, 0.2f, 0.1f);
+      world.addComponent<Health>(id, 100.0f);
+      world.addComponent<RenderState>(id, true);
+    }
+  }
+
+  auto start = high_resolution_clock::now();
+  float sum = 0.0f;
+  for (int frame = 0; frame < 10; ++frame) {
+    for (auto [id, pos, vel, acc, health, rs] : world.view<Position, Velocity, Acceleration, Health, RenderState>()) {
+      pos->x += vel->dx + acc->ax;
+      sum += health->current;
+    }
+  }
+  auto end = high_resolution_clock::now();
+
+  std::cout << label << " storage: " << sum << "\n";
+  std::cout << "Time: "
+            << duration_cast<microseconds>(end - start).count() << "us\n";
+}
+
+void demo_2_storage_modes() {
+  benchmark_storage_mode(StorageMode::Sparse, "Sparse");
+  benchmark_storage_mode(StorageMode::Archetype, "Archetype");
+}
+
+void demo_3_parallel_view() {
+  using namespace std::chrono;
+
+  constexpr int entityCount = 1'000'000;
+  JobSystem jobs;
+  World world;
+  registerDemoComponents(world);
+
+  for (int i = 0; i < entityCount; ++i) {
+    EntityId id = world.createEntity();
+    world.addComponent<Position>(id, float(i), float(i));
+    world.addComponent<Velocity>(id, 1.0f, 0.5f);
+  }
+
+  auto integrate = [](EntityId, Position& pos, Velocity& vel) {
+    pos.x += vel.dx * 0.016f;
+    pos.y += vel.dy * 0.016f;
+  };
+
+  auto start = high_resolution_clock::now();
+  world.view<Position, Velocity>().forEach(integrate);
+  auto end = high_resolution_clock::now();
+  std::cout << "View::forEach: "
+            << duration_cast<microseconds>(end - start).count() << "us\n";
+
+  start = high_resolution_clock::now();
+  world.view<Position, Velocity>().parallelForEach(jobs, integrate, 16'384);
+  end = high_resolution_clock::now();
+  std::cout << "View::parallelForEach (" << jobs.workerCount() << " workers): "
+            << duration_cast<microseconds>(end - start).count() << "us\n";
+}
+
+void demo_4_change_tracking() {
+  World world;
+  registerDemoComponents(world);
+
+  std::vector<EntityId> entities;
+  for (int i = 0; i < 100; ++i) {
+    EntityId id = world.createEntity();
+    world.addComponent<Position>(id, float(i), 0.0f);
+    entities.push_back(id);
+  }
+
+  world.advanceFrame();
+  const uint32_t start = world.currentTick();
+
+  // Touch every 10th position mutably and give a few entities health
+  for (size_t i = 0; i < entities.size(); i += 10) {
+    world.getComponent<Position>(entities[i])->y += 1.0f;
+  }
+  for (size_t i = 0; i < 3; ++i) {
+    world.addComponent<Health>(entities[i], 100.0f);
+  }
+
+  // Read-only access does not mark anything
+  float sum = 0.0f;
+  for (auto [id, pos] : world.view<const Position>()) {
+    sum += pos->x;
+  }
+
+  size_t changed = 0;
+  world.view<Changed<Position>>().forEach([&](EntityId, const Position&) { ++changed; });
+  size_t added = 0;
+  world.view<Added<Health>>().forEach([&](EntityId, const Health&) { ++added; });
+
+  world.advanceFrame();
+  world.getComponent<Position>(entities[1])->y += 1.0f;
+
+  size_t changedThisFrame = 0;
+  auto changedNow = world.view<Changed<Position>>();
+  for (auto it = changedNow.begin(); it != changedNow.end(); ++it) {
+    ++changedThisFrame;
+  }
+  size_t changedSinceStart = 0;
+  auto changedSince = world.view<Changed<Position>>().since(start);
+  for (auto it = changedSince.begin(); it != changedSince.end(); ++it) {
+    ++changedSinceStart;
+  }
+
+  std::cout << "\nChange tracking (100 entities, sum " << sum << ")\n"
+            << "  Changed<Position> frame 1: " << changed << "\n"
+            << "  Added<Health> frame 1:     " << added << "\n"
+            << "  Changed<Position> frame 2: " << changedThisFrame << "\n"
+            << "  Changed<Position> since 1: " << changedSinceStart << "\n";
+}
+
+void demo_5_command_buffers() {
+  JobSystem jobs;
+  World world;
+  registerDemoComponents(world);
+
+  std::vector<EntityId> entities;
+  for (int i = 0; i < 10'000; ++i) {
+    EntityId id = world.createEntity();
+    world.addComponent<Position>(id, float(i), 0.0f);
+    world.addComponent<Health>(id, float(i % 100));
+    entities.push_back(id);
+  }
+
+  jobs.beginFrame();
+
+  // Every range records into its worker's buffer. Keying the commands by range makes
+  // the playback order independent of which worker picked up which range.
+  jobs.parallelFor(entities.size(), 1024, [&](size_t begin, size_t end) {
+    CommandBuffer& commands = world.commands();
+    commands.setSortKey(static_cast<uint32_t>(begin));
+    for (size_t i = begin; i < end; ++i) {
+      const Health* health = world.getComponent<Health>(entities[i]);
+      if (health->current < 10.0f) {
+        commands.destroyEntity(entities[i]);
+        EntityId replacement = commands.createEntity();
+        commands.addComponent<Position>(replacement, 0.0f, 0.0f);
+        commands.addComponent<Health>(replacement, 100.0f);
+      }
+    }
+  });
+
+  world.flushCommands();
+  jobs.endFrame();
+
+  size_t destroyed = 0;
+  for (EntityId id : entities) {
+    if (!world.isAlive(id)) ++destroyed;
+  }
+  size_t respawned = 0;
+  for (auto [id, health] : world.view<const Health>()) {
+    if (health->current == 100.0f) ++respawned;
+  }
+  std::cout << "\nCommand buffers: " << destroyed << " destroyed, " << respawned << " respawned\n";
+}
+
+void benchmark_spawn(StorageMode mode, const char* label) {
+  using namespace std::chrono;
+  constexpr size_t count = 100'000;
+
+  {
+    World world(mode);
+    registerDemoComponents(world);
+    auto start = high_resolution_clock::now();
+    for (size_t i = 0; i < count; ++i) {
+      EntityId id = world.createEntity();
+      world.addComponent<Position>(id, float(i), 0.0f);
+      world.addComponent<Velocity>(id, 0.0f, 10.0f);
+      world.addComponent<Health>(id, 1.0f);
+    }
+    auto end = high_resolution_clock::now();
+    std::cout << label << " createEntity + addComponent: " << duration_cast<microseconds>(end - start).count() << "us\n";
+  }
+
+  {
+    World world(mode);
+    registerDemoComponents(world);
+    Prefab projectile;
+    projectile.with<Position>(0.0f, 0.0f).with<Velocity>(0.0f, 10.0f).with<Health>(1.0f);
+    auto start = high_resolution_clock::now();
+    world.instantiate(projectile, count);
+    auto end = high_resolution_clock::now();
+    std::cout << label << " instantiate(prefab):         " << duration_cast<microseconds>(end - start).count() << "us\n";
+  }
+
+  {
+    World world(mode);
+    registerDemoComponents(world);
+    auto start = high_resolution_clock::now();
+    world.spawnBatch<Position, Velocity>(count, [](size_t i, EntityId, Position& pos, Velocity& vel) {
+      pos.x = float(i);
+      vel.dy = 10.0f;
+    });
+    auto end = high_resolution_clock::now();
+    std::cout << label << " spawnBatch:                  " << duration_cast<microseconds>(end - start).count() << "us\n";
+  }
+}
+
+void demo_6_batch_spawn() {
+  std::cout << "\nSpawning 100k projectiles\n";
+  benchmark_spawn(StorageMode::Sparse, "Sparse   ");
+  benchmark_spawn(StorageMode::Archetype, "Archetype");
+}
+
+void demo_7_entity_cleanup() {
+  using namespace std::chrono;
+  constexpr size_t count = 100'000;
+
+  std::cout << "\nDestroying half of 100k entities\n";
+  for (bool deferred : {false, true}) {
+    World world;
+    registerDemoComponents(world);
+    Prefab particle;
+    particle.with<Position>(0.0f, 0.0f).with<Velocity>(1.0f, 1.0f).with<Health>(1.0f);
+    std::vector<EntityId> ids = world.instantiate(particle, count);
+
+    auto start = high_resolution_clock::now();
+    for (size_t i = 0; i < ids.size(); i += 2) {
+      if (deferred) {
+        world.destroyEntityDeferred(ids[i]);
+      } else {
+        world.destroyEntity(ids[i]);
+      }
+    }
+    const size_t rowsBeforeFlush = world.view<Position>().size();
+    world.flushDestroyedEntities();
+    auto end = high_resolution_clock::now();
+
+    std::cout << (deferred ? "  deferred:  " : "  immediate: ") << duration_cast<microseconds>(end - start).count() << "us"
+              << ", Position rows " << rowsBeforeFlush << " -> " << world.view<Position>().size() << "\n";
+  }
+}
+
+void demo_8_tag_queries() {
+  using namespace std::chrono;
+  constexpr int count = 100'000;
+
+  World world;
+  const TagId enemy = TagRegistry::instance().intern("enemy"_tag);
+  const TagId alive = TagRegistry::instance().intern("alive"_tag);
+  for (int i = 0; i < count; ++i) {
+    EntityId id = world.createEntity();
+    if (i % 3 == 0) world.addTag(id, enemy);
+    if (i % 2 == 0) world.addTag(id, alive);
+  }
+
+  auto start = high_resolution_clock::now();
+  size_t matches = 0;
+  for (EntityId id : world.findWithTags({"enemy"_tag, "alive"_tag})) {
+    matches += world.isAlive(id);
+  }
+  auto end = high_resolution_clock::now();
+
+  std::cout << "\nTag query enemy+alive over 100k entities: " << matches << " matches in "
+            << duration_cast<microseconds>(end - start).count() << "us\n";
+}
+
+void demo_9_snapshot() {
+  using namespace std::chrono;
+  constexpr size_t count = 500'000;
+  const std::string path = (std::filesystem::temp_directory_path() / "week18_snapshot.bin").string();
+
+  World source;
+  registerDemoComponents(source);
+  Prefab unit;
+  unit.with<Position>(0.0f, 0.0f).with<Velocity>(1.0f, 0.5f).with<Health>(100.0f);
+  source.instantiate(unit, count);
+
+  auto start = high_resolution_clock::now();
+  source.saveSnapshot(path);
+  auto saved = high_resolution_clock::now();
+
+  World loaded;
+  registerDemoComponents(loaded);
+  loaded.loadSnapshot(path);
+  auto end = high_resolution_clock::now();
+
+  std::cout << "\nSnapshot of " << count << " entities: saved in " << duration_cast<milliseconds>(saved - start).count()
+            << "ms, loaded in " << duration_cast<milliseconds>(end - saved).count() << "ms, "
+            << loaded.view<Position, Velocity, Health>().size() << " entities restored\n";
+  std::filesystem::remove(path);
+}
+
+void demo_10_scene_loading() {
+  constexpr int count = 100'000;
+  const std::string path = (std::filesystem::temp_directory_path() / "week18_scene.json").string();
+
+  nlohmann::json entities = nlohmann::json::array();
+  for (int i = 0; i < count; ++i) {
+    nlohmann::json entity;
+    entity["components"]["Position"] = {{"x", i}, {"y", 0}};
+    entity["components"]["Velocity"] = {{"dx", 1}, {"dy", 0.5}};
+    entity["components"]["Health"] = {{"current", 100}};
+    if (i % 10 == 0) entity["tags"] = {"enemy"};
+    entities.push_back(std::move(entity));
+  }
+  std::ofstream(path) << nlohmann::json{{"entities", entities}}.dump();
+
+  JobSystem jobs;
+  World world;
+  registerDemoComponents(world);
+
+  SceneLoader loader(world, jobs);
+  std::vector<EntityId> ids = loader.loadFile(path);
+  world.validate();
+  std::filesystem::remove(path);
+
+  const SceneLoadStats& stats = loader.stats();
+  std::cout << "\nScene load of " << ids.size() << " entities in " << stats.chunks << " chunks: read "
+            << stats.read.count() << "us, parse " << stats.parse.count() << "us, deserialize "
+            << stats.deserialize.count() << "us, merge " << stats.merge.count() << "us\n";
+}
+
+void demo_11_rollback() {
+  using namespace std::chrono;
+  constexpr size_t count = 50'000;
+  constexpr uint32_t frames = 10;
+
+  World world;
+  registerDemoComponents(world);
+  Prefab unit;
+  unit.with<Position>(0.0f, 0.0f).with<Velocity>(1.0f, 0.5f);
+  const EntityId probe = world.instantiate(unit, count).back();
+
+  auto step = [&]() {
+    world.view<Position, const Velocity>().forEach([](EntityId, Position& p, const Velocity& v) {
+      p.x += v.dx;
+      p.y += v.dy;
+    });
+    world.advanceFrame();
+  };
+
+  RollbackBuffer rollback(frames + 1, 4 << 20);
+  const uint32_t confirmed = world.currentTick();
+  for (uint32_t i = 0; i < frames; ++i) {
+    rollback.capture(world);
+    step();
+  }
+  const Position expected = *world.getComponent<Position>(probe);
+
+  auto start = high_resolution_clock::now();
+  rollback.restore(world, confirmed);
+  auto restored = high_resolution_clock::now();
+  for (uint32_t i = 0; i < frames; ++i) {
+    step();
+  }
+  auto end = high_resolution_clock::now();
+  const Position resimulated = *world.getComponent<Position>(probe);
+
+  std::cout << "\nRollback of " << count << " entities (" << rollback.frameBytes(confirmed) << " bytes per frame): restore "
+            << duration_cast<microseconds>(restored - start).count() << "us, " << frames << " frame resimulation "
+            << duration_cast<microseconds>(end - restored).count() << "us, "
+            << (expected.x == resimulated.x && expected.y == resimulated.y ? "deterministic" : "diverged") << "\n";
+}
+
+void demo_12_cached_query() {
+  using namespace std::chrono;
+  constexpr int count = 100'000;
+
+  World world;
+  for (int i = 0; i < count; ++i) {
+    EntityId id = world.createEntity();
+    if (i % 2 == 0) world.addComponent<Health>(id, 100.0f);
+    if (i % 3 == 0) world.addComponent<Position>(id, 0.0f, 0.0f);
+  }
+  Query<const Position, Health>& query = world.query<const Position, Health>();
+
+  float total = 0.0f;
+  auto start = high_resolution_clock::now();
+  world.view<const Position, Health>().forEach([&](EntityId, const Position&, Health& h) { total += h.current; });
+  auto viewed = high_resolution_clock::now();
+  query.forEach([&](EntityId, const Position&, Health& h) { total += h.current; });
+  auto end = high_resolution_clock::now();
+
+  std::cout << "\nPosition+Health over " << count << " entities, " << query.size() << " matches: view "
+            << duration_cast<microseconds>(viewed - start).count() << "us, cached query "
+            << duration_cast<microseconds>(end - viewed).count() << "us\n";
+}
+
+void demo_13_transform_hierarchy() {
+  using namespace std::chrono;
+  constexpr int roots = 20'000;
+
+  World world;
+  auto spawn = [&](float x, float y, float z) {
+    EntityId id = world.createEntity();
+    world.addComponent<LocalTransform>(id, Mat4f::translation(x, y, z));
+    world.addComponent<WorldTransform>(id);
+    return id;
+  };
+
+  // Children are linked before their parents get one, so the storage starts out of depth order
+  std::vector<EntityId> leaves;
+  for (int i = 0; i < roots; ++i) {
+    EntityId root = spawn(1.0f, 0.0f, 0.0f);
+    EntityId child = spawn(0.0f, 1.0f, 0.0f);
+    EntityId leaf = spawn(0.0f, 0.0f, 1.0f);
+    world.setParent(leaf, child);
+    world.setParent(child, root);
+    leaves.push_back(leaf);
+  }
+  world.setParent(leaves[1], leaves[0]);
+  world.destroyEntity(world.parentOf(leaves[2]));
+
+  JobSystem jobs;
+  TransformSystem transforms(jobs);
+  auto start = high_resolution_clock::now();
+  transforms.update(world, 0.0f);
+  auto end = high_resolution_clock::now();
+
+  auto printTranslation = [&](const char* label, EntityId id) {
+    alignas(16) float t[4];
+    _mm_store_ps(t, world.getComponent<WorldTransform>(id)->matrix.row(3));
+    std::cout << "  " << label << " (" << t[0] << ", " << t[1] << ", " << t[2] << ")\n";
+  };
+  std::cout << "\nTransforms of " << world.storage<Hierarchy>().size() << " entities over "
+            << transforms.levelStarts().size() - 1 << " levels in "
+            << duration_cast<microseconds>(end - start).count() << "us\n";
+  printTranslation("leaf", leaves[3]);
+  printTranslation("reparented leaf", leaves[1]);
+  printTranslation("orphaned leaf", leaves[2]);
+}
+
+void demo_14_spatial_hash() {
+  using namespace std::chrono;
+  constexpr int count = 100'000;
+  constexpr int queries = 100;
+  constexpr float radius = 5.0f;
+
+  World world;
+  std::vector<EntityId> ids;
+  for (int i = 0; i < count; ++i) {
+    EntityId id = world.createEntity();
+    world.addComponent<Position>(id, static_cast<float>(i % 1000), static_cast<float>(i / 100));
+    ids.push_back(id);
+  }
+  SpatialHash<Position>& hash = world.spatialHash<Position>(2.0f * radius);
+
+  // Move a tenth of the entities, only those are re-bucketed
+  world.advanceFrame();
+  for (int i = 0; i < count; i += 10) {
+    world.getComponent<Position>(ids[i])->x += 25.0f;
+  }
+  const size_t moved = hash.update();
+
+  size_t scanned = 0;
+  auto start = high_resolution_clock::now();
+  for (int q = 0; q < queries; ++q) {
+    const float cx = static_cast<float>(q % 1000), cy = static_cast<float>(q % 1000);
+    world.view<const Position>().forEach([&](EntityId, const Position& p) {
+      scanned += (p.x - cx) * (p.x - cx) + (p.y - cy) * (p.y - cy) <= radius * radius;
+    });
+  }
+  auto viewed = high_resolution_clock::now();
+  size_t found = 0;
+  std::vector<EntityId> results;
+  for (int q = 0; q < queries; ++q) {
+    const float cx = static_cast<float>(q % 1000), cy = static_cast<float>(q % 1000);
+    found += hash.queryRadius(cx, cy, radius, results).size();
+  }
+  auto end = high_resolution_clock::now();
+
+  std::cout << "\nRadius queries over " << count << " entities (" << moved << " changed cell): scan "
+            << duration_cast<microseconds>(viewed - start).count() << "us, spatial hash "
+            << duration_cast<microseconds>(end - viewed).count() << "us, "
+            << (found == scanned ? "same" : "different") << " results\n";
+}
+
+void demo_15_frame_graph() {
+  using namespace std::chrono;
+  constexpr int frames = 10'000;
+  constexpr int count = 200'000;
+
+  JobSystem jobs;
+  World world;
+  registerDemoComponents(world);
+  world.group<Position, Velocity>();
+  world.group<Position, Velocity, Acceleration>();
+  world.query<const Position, Health>();
+
+  world.registerSystem<InputSystem>();
+  world.registerSystem<AccelerationSystem>();
+  world.registerSystem<PhysicsSystem>();
+  world.registerSystem<RenderSystem>();
+  world.registerSystem<DamageSystem>();
+
+  // The first call compiles the graph, every later one only re-arms it
+  auto start = high_resolution_clock::now();
+  TaskGraph& graph = world.executionGraph(1.0f);
+  auto compiled = high_resolution_clock::now();
+  for (int frame = 0; frame < frames; ++frame) {
+    world.executionGraph(1.0f);
+  }
+  auto end = high_resolution_clock::now();
+  jobs.execute(graph);
+
+  std::cout << "\nFrame graph of " << graph.size() << " tasks: compile "
+            << duration_cast<nanoseconds>(compiled - start).count() << "ns, re-arm "
+            << duration_cast<nanoseconds>(end - compiled).count() / frames << "ns per frame\n";
+
+  Prefab mover;
+  mover.with<Position>(0.0f, 0.0f).with<Velocity>(1.0f, 1.0f).with<Acceleration>(0.1f, 0.1f).with<Health>(1000.0f);
+  world.instantiate(mover, count);
+
+  // PhysicsSystem kept in one task, then fanned out over the workers
+  for (size_t parallelism : {size_t{1}, jobs.workerCount()}) {
+    world.setSystemParallelism(parallelism);
+    auto frameStart = high_resolution_clock::now();
+    jobs.execute(world.executionGraph(1.0f));
+    world.flushCommands();
+    auto frameEnd = high_resolution_clock::now();
+    std::cout << "  " << count << " movers, parallelism " << parallelism << ": "
+              << world.systemGraph().size() << " tasks, frame "
+              << duration_cast<microseconds>(frameEnd - frameStart).count() << "us\n";
+  }
+}
+
+void demo_16_profiler() {
+  constexpr int count = 100'000;
+  constexpr int frames = 3;
+  const std::string path = (std::filesystem::temp_directory_path() / "week18_trace.json").string();
+
+  JobSystem jobs;
+  World world;
+  registerDemoComponents(world);
+  world.group<Position, Velocity>();
+  world.group<Position, Velocity, Acceleration>();
+  world.query<const Position, Health>();
+
+  world.registerSystem<InputSystem>();
+  world.registerSystem<AccelerationSystem>();
+  world.registerSystem<PhysicsSystem>();
+  world.registerSystem<RenderSystem>();
+  world.registerSystem<DamageSystem>();
+  world.setSystemParallelism(jobs.workerCount());
+
+  Prefab mover;
+  mover.with<Position>(0.0f, 0.0f).with<Velocity>(1.0f, 1.0f).with<Acceleration>(0.1f, 0.1f).with<Health>(1000.0f);
+  world.instantiate(mover, count);
+
+  Profiler& profiler = Profiler::instance();
+  Profiler::setEnabled(true);
+  jobs.beginFrame();
+  const uint32_t first = profiler.frame();
+  for (int frame = 0; frame < frames; ++frame) {
+    if (frame > 0) jobs.beginFrame();
+    world.advanceFrame();
+    jobs.execute(world.executionGraph(1.0f));
+    world.flushCommands();
+    jobs.endFrame();
+  }
+  Profiler::setEnabled(false);
+
+  std::ofstream trace(path);
+  profiler.writeChromeTrace(trace, first, profiler.frame());
+  std::cout << "\nProfiled " << frames << " frames of " << count << " movers, trace in " << path << "\n";
+  profiler.summarize(world.systemGraph(), profiler.frame()).print(std::cout);
+}
+
+void demo_17_system_rates() {
+  JobSystem jobs;
+  World world;
+  registerDemoComponents(world);
+  world.query<const Position, Velocity>();
+
+  world.registerSystem<PhysicsSystem>();
+  auto& fixed = world.registerSystem<FixedStepSystem>();
+  auto& ai = world.registerSystem<AiSystem>();
+
+  Prefab mover;
+  mover.with<Position>(0.0f, 0.0f).with<Velocity>(150.0f, 50.0f);
+  world.instantiate(mover, 1000);
+
+  // One simulated second of uneven frames, 30 to 144 fps with a single long stall
+  const float frameTimes[] = {1.0f / 144.0f, 1.0f / 60.0f, 1.0f / 30.0f, 1.0f / 90.0f};
+  float simulated = 0.0f;
+  int frames = 0;
+  while (simulated < 1.0f) {
+    const float dt = frames == 20 ? 0.25f : frameTimes[frames % 4];
+    jobs.beginFrame();
+    world.advanceFrame();
+    jobs.execute(world.executionGraph(dt));
+    world.flushCommands();
+    jobs.endFrame();
+    simulated += dt;
+    ++frames;
+  }
+
+  std::cout << "\nSystem rates over " << simulated << "s in " << frames << " frames\n";
+  std::cout << "  FixedStepSystem (60 Hz): " << fixed.steps << " steps, " << fixed.simulated << "s simulated\n";
+  std::cout << "  AiSystem (10 Hz): " << ai.runs << " runs, " << ai.elapsed << "s elapsed\n";
+}
+
+void demo_18_component_allocation() {
+  constexpr int count = 5000;
+
+  World world;
+  world.registerComponent<Position>(nullptr);
+  world.registerComponent<Velocity>(nullptr, ComponentAllocation::Pool);
+  world.registerComponent<Impulse>(nullptr, ComponentAllocation::Frame);
+
+  Prefab mover;
+  mover.with<Position>(0.0f, 0.0f).with<Velocity>(1.0f, 0.0f);
+  const std::vector<EntityId> ids = world.instantiate(mover, count);
+
+  std::cout << "\nComponent allocation per type\n";
+  for (int frame = 0; frame < 3; ++frame) {
+    world.advanceFrame();
+    // Impulses added this frame are gone again after the next advanceFrame
+    for (size_t i = 0; i < ids.size(); i += frame + 2) {
+      world.addComponent<Impulse>(ids[i], 0.5f, 0.0f);
+    }
+    for (auto [id, vel, impulse] : world.view<Velocity, Impulse>()) {
+      vel->dx += impulse->x;
+    }
+    world.reportComponentMemory();
+    std::cout << "  Frame " << frame << ": " << world.storage<Impulse>().size() << " impulses, "
+              << "Position " << AllocatorTagRegistry::getUsageForTag("Component/Position") << "B (heap), "
+              << "Velocity " << AllocatorTagRegistry::getUsageForTag("Component/Velocity") << "B (pool, "
+              << AllocatorTagRegistry::getUsageForTag("ComponentPool") << "B held), "
+              << "Impulse " << AllocatorTagRegistry::getUsageForTag("Component/Impulse") << "B (frame)\n";
+  }
+  world.advanceFrame();
+  std::cout << "  After advancing: " << world.storage<Impulse>().size() << " impulses, "
+            << AllocatorTagRegistry::getUsageForTag("Component/Impulse") << "B, entity 0 dx "
+            << world.getComponent<Velocity>(ids[0])->dx << "\n";
+}
 
 int main() {
   std::cout << "WEEK 18: Memory -> ECS Integration\n";
-}
\ No newline at end of file
+  demo_1_parallel_systems();
+  demo_2_storage_modes();
+  demo_3_parallel_view();
+  demo_4_change_tracking();
+  demo_5_command_buffers();
+  demo_6_batch_spawn();
+  demo_7_entity_cleanup();
+  demo_8_tag_queries();
+  demo_9_snapshot();
+  demo_10_scene_loading();
+  demo_11_rollback();
+  demo_12_cached_query();
+  demo_13_transform_hierarchy();
+  demo_14_spatial_hash();
+  demo_15_frame_graph();
+  demo_16_profiler();
+  demo_17_system_rates();
+  demo_18_component_allocation();
+}
@@ -5,10 +5,12 @@
 
 std::unordered_map<const void*, AllocatorTagRegistry::TagInfo> AllocatorTagRegistry::_allocators;
 std::unordered_map<std::string, size_t> AllocatorTagRegistry::_tagTotals;
+std::mutex AllocatorTagRegistry::_mutex;
 
 void AllocatorTagRegistry::track(const void* allocatorPtr, const std::string& tag, size_t capacity) {
   assert(allocatorPtr != nullptr);
   assert(capacity > 0 && "Tracked capacity must be greater than 0");
+  std::lock_guard lock(_mutex);
 
   if (_allocators.contains(allocatorPtr)) {
     std::cerr << "[AllocatorTagRegistry] Warning: allocatorPtr already tracked.\n";
@@ -20,6 +22,7 @@ void AllocatorTagRegistry::track(const void* allocatorPtr, const std::string& ta
 }
 
 void AllocatorTagRegistry::untrack(const void* allocatorPtr) {
+  std::lock_guard lock(_mutex);
   auto it = _allocators.find(allocatorPtr);
   if (it == _allocators.end()) {
     std::cerr << "[AllocatorTagRegistry] Warning: allocatorPtr not found in untrack.\n";
@@ -35,12 +38,28 @@ void AllocatorTagRegistry::untrack(const void* allocatorPtr) {
   _allocators.erase(it);
 }
 
+void AllocatorTagRegistry::resize(const void* allocatorPtr, size_t capacity) {
+  std::lock_guard lock(_mutex);
+  auto it = _allocators.find(allocatorPtr);
+  if (it == _allocators.end()) {
+    std::cerr << "[AllocatorTagRegistry] Warning: allocatorPtr not found in resize.\n";
+    return;
+  }
+
+  auto& info = it->second;
+  size_t& total = _tagTotals[info.tag];
+  total = total - info.capacity + capacity;
+  info.capacity = capacity;
+}
+
 size_t AllocatorTagRegistry::getUsageForTag(const std::string& tag) {
+  std::lock_guard lock(_mutex);
   auto it = _tagTotals.find(tag);
   return it != _tagTotals.end() ? it->second : 0;
 }
 
 void AllocatorTagRegistry::printStats() {
+  std::lock_guard lock(_mutex);
   std::cout << "=== AllocatorTagRegistry Stats ===\n";
   for (const auto& [tag, total] : _tagTotals) {
     std::cout << "Tag: " << tag << " → " << total << " bytes\n";
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <cstddef>
+#include <mutex>
 #include <string>
 #include <unordered_map>
 
@@ -8,6 +9,9 @@ class AllocatorTagRegistry {
  public:
   static void track(const void* allocatePtr, const std::string& tag, size_t capacity);
   static void untrack(const void* allocatePtr);
+  // Updates the capacity of a tracked allocator that grows and shrinks, like a
+  // TrackedResource reporting its live bytes
+  static void resize(const void* allocatePtr, size_t capacity);
   static size_t getUsageForTag(const std::string& tag);
   static void printStats();
 
@@ -19,4 +23,5 @@ class AllocatorTagRegistry {
 
   static std::unordered_map<const void*, TagInfo> _allocators;
   static std::unordered_map<std::string, size_t> _tagTotals;
+  static std::mutex _mutex;
 };
\ No newline at end of file
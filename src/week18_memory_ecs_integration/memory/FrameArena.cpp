@@ -34,3 +34,7 @@ void FrameArena::reset() { _ptr = _start; }
 size_t FrameArena::used() const { return static_cast<size_t>(_ptr - _start); }
 size_t FrameArena::capacity() const { return _size; }
 size_t FrameArena::remaining() const { return _size - used(); }
+bool FrameArena::owns(const void* ptr) const {
+  const auto* byte = static_cast<const std::byte*>(ptr);
+  return byte >= _start && byte < _start + _size;
+}
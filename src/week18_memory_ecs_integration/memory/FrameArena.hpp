@@ -24,6 +24,8 @@ class FrameArena {
   size_t used() const;
   size_t capacity() const;
   size_t remaining() const;
+  // Whether ptr points into the arena's buffer
+  bool owns(const void* ptr) const;
 
  private:
   std::byte* _start = nullptr;
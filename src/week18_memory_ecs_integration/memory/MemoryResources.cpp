@@ -0,0 +1,115 @@
+#include "MemoryResources.hpp"
+
+#include <algorithm>
+#include <new>
+#include <utility>
+
+#include "AllocatorTagRegistry.hpp"
+
+TrackedResource::TrackedResource(std::string tag, std::pmr::memory_resource* upstream)
+    : _tag(std::move(tag)), _upstream(upstream) {}
+
+TrackedResource::~TrackedResource() {
+  if (_tracked) {
+    AllocatorTagRegistry::untrack(this);
+  }
+}
+
+void* TrackedResource::do_allocate(size_t bytes, size_t alignment) {
+  void* ptr = _upstream->allocate(bytes, alignment);
+  _bytes.fetch_add(bytes, std::memory_order_relaxed);
+  return ptr;
+}
+
+void TrackedResource::do_deallocate(void* ptr, size_t bytes, size_t alignment) {
+  _upstream->deallocate(ptr, bytes, alignment);
+  _bytes.fetch_sub(bytes, std::memory_order_relaxed);
+}
+
+void TrackedResource::report() {
+  // The registry only tracks allocators with a capacity, so the first report registers
+  const size_t current = bytes();
+  if (_tracked) {
+    AllocatorTagRegistry::resize(this, current);
+  } else if (current > 0) {
+    AllocatorTagRegistry::track(this, _tag, current);
+    _tracked = true;
+  }
+}
+
+PoolResource::PoolResource(std::string tag, std::pmr::memory_resource* upstream)
+    : _tag(std::move(tag)), _upstream(upstream) {}
+
+PoolResource::~PoolResource() {
+  if (!_chunks.empty()) {
+    AllocatorTagRegistry::untrack(this);
+  }
+  for (const Chunk& chunk : _chunks) {
+    _upstream->deallocate(chunk.memory, chunk.bytes, alignof(std::max_align_t));
+  }
+}
+
+size_t PoolResource::blocksInUse() const {
+  size_t count = 0;
+  for (const SizeClass& sizeClass : _classes) count += sizeClass.inUse;
+  return count;
+}
+
+void* PoolResource::do_allocate(size_t bytes, size_t alignment) {
+  if (!pooled(bytes, alignment)) {
+    return _upstream->allocate(bytes, alignment);
+  }
+  const size_t index = classOf(bytes);
+  SizeClass& sizeClass = _classes[index];
+  if (!sizeClass.free) {
+    refill(index);
+  }
+  FreeBlock* block = sizeClass.free;
+  sizeClass.free = block->next;
+  ++sizeClass.inUse;
+  return block;
+}
+
+void PoolResource::do_deallocate(void* ptr, size_t bytes, size_t alignment) {
+  if (!pooled(bytes, alignment)) {
+    _upstream->deallocate(ptr, bytes, alignment);
+    return;
+  }
+  SizeClass& sizeClass = _classes[classOf(bytes)];
+  sizeClass.free = new (ptr) FreeBlock{sizeClass.free};
+  --sizeClass.inUse;
+}
+
+void PoolResource::refill(size_t sizeClass) {
+  SizeClass& target = _classes[sizeClass];
+  const size_t block = blockSize(sizeClass);
+  const size_t bytes = block * target.chunkBlocks;
+  auto* memory = static_cast<std::byte*>(_upstream->allocate(bytes, alignof(std::max_align_t)));
+  _chunks.push_back(Chunk{memory, bytes});
+  target.chunkBlocks = std::max<size_t>(std::min(target.chunkBlocks * 2, ChunkSize / block), 1);
+
+  // Thread the blocks back to front so they are handed out in address order
+  FreeBlock* free = target.free;
+  for (size_t offset = bytes; offset >= block; offset -= block) {
+    free = new (memory + offset - block) FreeBlock{free};
+  }
+  target.free = free;
+
+  if (_bytesHeld == 0) {
+    AllocatorTagRegistry::track(this, _tag, bytes);
+  } else {
+    AllocatorTagRegistry::resize(this, _bytesHeld + bytes);
+  }
+  _bytesHeld += bytes;
+}
+
+void* FrameResource::do_allocate(size_t bytes, size_t alignment) {
+  void* ptr = _arena.allocateRaw(std::max<size_t>(bytes, 1), alignment);
+  return ptr ? ptr : _upstream->allocate(bytes, alignment);
+}
+
+void FrameResource::do_deallocate(void* ptr, size_t bytes, size_t alignment) {
+  if (!_arena.owns(ptr)) {
+    _upstream->deallocate(ptr, bytes, alignment);
+  }
+}
@@ -0,0 +1,127 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+#include <string>
+#include <vector>
+
+#include "FrameArena.hpp"
+
+//
+//  std::pmr adapters over the allocators of this module, so that pmr containers
+//  can draw from them
+//
+
+//
+//  Forwards to upstream and counts the bytes currently allocated through it. The
+//  count is only pushed to the AllocatorTagRegistry under tag by report(), keeping
+//  the registry lock off the allocation path. Not synchronized, apart from the count.
+//
+class TrackedResource : public std::pmr::memory_resource {
+ public:
+  explicit TrackedResource(std::string tag, std::pmr::memory_resource* upstream = std::pmr::get_default_resource());
+  ~TrackedResource() override;
+
+  TrackedResource(const TrackedResource&) = delete;
+  TrackedResource& operator=(const TrackedResource&) = delete;
+
+  const std::string& tag() const { return _tag; }
+  std::pmr::memory_resource* upstream() const { return _upstream; }
+  size_t bytes() const { return _bytes.load(std::memory_order_relaxed); }
+
+  // Publishes the current count to the registry
+  void report();
+
+ private:
+  std::string _tag;
+  std::pmr::memory_resource* _upstream;
+  std::atomic<size_t> _bytes = 0;
+  bool _tracked = false;
+
+  void* do_allocate(size_t bytes, size_t alignment) override;
+  void do_deallocate(void* ptr, size_t bytes, size_t alignment) override;
+  bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override { return this == &other; }
+};
+
+//
+//  Size class pool. Requests of up to MaxBlockSize bytes are rounded up to a power
+//  of two no smaller than MinBlockSize and served from the free list of that class,
+//  larger or over-aligned requests go to upstream. Every class carves its blocks from
+//  upstream chunks that start at one block and double up to ChunkSize, which are
+//  only returned when the resource is destroyed. The bytes of those chunks are
+//  reported to the AllocatorTagRegistry under tag. Not synchronized.
+//
+class PoolResource : public std::pmr::memory_resource {
+ public:
+  static constexpr size_t MinBlockSize = 64;
+  static constexpr size_t MaxBlockSize = 256 * 1024;
+  static constexpr size_t ChunkSize = 1024 * 1024;
+
+  explicit PoolResource(std::string tag, std::pmr::memory_resource* upstream = std::pmr::get_default_resource());
+  ~PoolResource() override;
+
+  PoolResource(const PoolResource&) = delete;
+  PoolResource& operator=(const PoolResource&) = delete;
+
+  // Blocks handed out and bytes taken from upstream for chunks
+  size_t blocksInUse() const;
+  size_t bytesHeld() const { return _bytesHeld; }
+
+ private:
+  struct FreeBlock {
+    FreeBlock* next;
+  };
+  struct SizeClass {
+    FreeBlock* free = nullptr;
+    size_t inUse = 0;
+    size_t chunkBlocks = 1;
+  };
+  struct Chunk {
+    std::byte* memory;
+    size_t bytes;
+  };
+  static constexpr size_t ClassCount = std::bit_width(MaxBlockSize / MinBlockSize);
+
+  std::string _tag;
+  std::pmr::memory_resource* _upstream;
+  std::array<SizeClass, ClassCount> _classes{};
+  std::vector<Chunk> _chunks;
+  size_t _bytesHeld = 0;
+
+  static bool pooled(size_t bytes, size_t alignment) {
+    return bytes <= MaxBlockSize && alignment <= alignof(std::max_align_t);
+  }
+  static size_t classOf(size_t bytes) { return std::bit_width((std::max(bytes, MinBlockSize) - 1) / MinBlockSize); }
+  static size_t blockSize(size_t sizeClass) { return MinBlockSize << sizeClass; }
+
+  void* do_allocate(size_t bytes, size_t alignment) override;
+  void do_deallocate(void* ptr, size_t bytes, size_t alignment) override;
+  bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override { return this == &other; }
+
+  void refill(size_t sizeClass);
+};
+
+//
+//  Bump allocates from a FrameArena and never frees, the memory comes back with the
+//  arena's reset. Requests that no longer fit go to upstream and are freed normally.
+//
+class FrameResource : public std::pmr::memory_resource {
+ public:
+  explicit FrameResource(FrameArena& arena, std::pmr::memory_resource* upstream = std::pmr::get_default_resource())
+      : _arena(arena), _upstream(upstream) {}
+
+  FrameArena& arena() const { return _arena; }
+
+ private:
+  FrameArena& _arena;
+  std::pmr::memory_resource* _upstream;
+
+  void* do_allocate(size_t bytes, size_t alignment) override;
+  void do_deallocate(void* ptr, size_t bytes, size_t alignment) override;
+  bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override { return this == &other; }
+};
@@ -1,17 +1,42 @@
 #include "JobSystem.hpp"
 
-JobSystem::JobSystem(size_t workerCount) : _threadPool(workerCount, 1024) {}
+#include <span>
+#include <string>
 
-void JobSystem::execute(TaskGraph& graph) {
-  bool workRemaning = true;
+#include "../memory/ThreadArenaRegistry.hpp"
+#include "Profiler.hpp"
+
+JobSystem::JobSystem(size_t workerCount)
+    : _arenaMemory(std::make_unique<std::byte[]>(FrameArenaSize * (workerCount + 1))),
+      _arenas(makeArenas(_arenaMemory.get(), workerCount + 1)),
+      _previousArena(ThreadArenaRegistry::get()),
+      _threadPool(workerCount, 1024, [this](size_t worker) {
+        ThreadArenaRegistry::set(_arenas[worker].get());
+        Profiler::setThreadName("Worker " + std::to_string(worker));
+      }) {
+  ThreadArenaRegistry::set(_arenas.back().get());
+  Profiler::setThreadName("Main");
+}
+
+JobSystem::~JobSystem() {
+  if (ThreadArenaRegistry::get() == _arenas.back().get()) {
+    ThreadArenaRegistry::set(_previousArena);
+  }
+}
+
+std::vector<std::unique_ptr<FrameArena>> JobSystem::makeArenas(std::byte* memory, size_t count) {
+  std::vector<std::unique_ptr<FrameArena>> arenas;
+  arenas.reserve(count);
+  for (size_t i = 0; i < count; ++i) {
+    arenas.push_back(std::make_unique<FrameArena>(std::span<std::byte>(memory + i * FrameArenaSize, FrameArenaSize)));
+  }
+  return arenas;
+}
 
-  while (workRemaning) {
-    auto readyJobs = graph.fetchReadyJobs();
-    for (auto& [id, job] : readyJobs) {
-      submit(std::move(job));
-    }
+void JobSystem::execute(TaskGraph& graph) {
+  while (!graph.isComplete()) {
+    graph.submitReadyJobs([this](Job<>&& job) { submit(std::move(job)); });
     waitForCompletion();
-    workRemaning = !graph.isComplete();
   }
 }
 
@@ -23,9 +48,18 @@ void JobSystem::waitForCompletion() {
   _threadPool.waitForIdle();
 }
 
+size_t JobSystem::workerCount() const {
+  return _threadPool.workerCount();
+}
+
 void JobSystem::beginFrame() {
-  // eventually this is for frame allocators, and any top of the
-  // frame stuff and for any frame-local stuff
+  // Workers are idle between frames, so their arenas can be reset from here.
+  // Anything recorded into them (e.g. command buffers) has to be consumed by now.
+  waitForCompletion();
+  for (auto& arena : _arenas) {
+    arena->reset();
+  }
+  Profiler::instance().nextFrame();
 }
 
 void JobSystem::endFrame() {
@@ -1,7 +1,10 @@
 #pragma once
 
+#include <algorithm>
 #include <atomic>
 #include <functional>
+#include <memory>
+#include <thread>
 #include <unordered_map>
 #include <utility>
 #include <vector>
@@ -9,21 +12,73 @@
 #include "../async/Job.hpp"
 #include "../async/LockFreeQueue.hpp"
 #include "../async/ThreadPool.hpp"
+#include "../memory/FrameArena.hpp"
 #include "TaskGraph.hpp"
 #include "TaskId.hpp"
 
+//
+//  Every worker, and the thread that owns the JobSystem, gets a FrameArena registered
+//  with ThreadArenaRegistry. The arenas are reset in beginFrame().
+//
 class JobSystem {
  public:
+  static constexpr size_t FrameArenaSize = 1 << 20;
+
   JobSystem(size_t workerCount = 4);
-  ~JobSystem() = default;
+  ~JobSystem();
+
+  JobSystem(const JobSystem&) = delete;
+  JobSystem& operator=(const JobSystem&) = delete;
 
   void execute(TaskGraph& graph);
   void submit(Job<>&& job);
   void waitForCompletion();
 
+  // Splits [0, count) into grainSize ranges and runs fn(begin, end) for each one on the
+  // pool, returning once all of them are done. The calling thread runs the first range
+  // and then helps drain the queues, so this is safe to call from inside a job.
+  template <typename Fn>
+  void parallelFor(size_t count, size_t grainSize, Fn&& fn);
+
+  size_t workerCount() const;
+
   void beginFrame();
   void endFrame();
 
  private:
+  // One arena per worker, the last one belongs to the owning thread
+  std::unique_ptr<std::byte[]> _arenaMemory;
+  std::vector<std::unique_ptr<FrameArena>> _arenas;
+  FrameArena* _previousArena = nullptr;
+
   ThreadPool _threadPool;
-};
\ No newline at end of file
+
+  static std::vector<std::unique_ptr<FrameArena>> makeArenas(std::byte* memory, size_t count);
+};
+
+template <typename Fn>
+void JobSystem::parallelFor(size_t count, size_t grainSize, Fn&& fn) {
+  if (count == 0) {
+    return;
+  }
+  grainSize = std::max<size_t>(grainSize, 1);
+  const size_t rangeCount = (count + grainSize - 1) / grainSize;
+
+  std::atomic<size_t> remaining{rangeCount - 1};
+  for (size_t range = 1; range < rangeCount; ++range) {
+    const size_t begin = range * grainSize;
+    const size_t end = std::min(begin + grainSize, count);
+    _threadPool.enqueue([&fn, &remaining, begin, end]() {
+      fn(begin, end);
+      remaining.fetch_sub(1, std::memory_order_release);
+    });
+  }
+
+  fn(size_t{0}, std::min(grainSize, count));
+
+  while (remaining.load(std::memory_order_acquire) > 0) {
+    if (!_threadPool.runPendingJob()) {
+      std::this_thread::yield();
+    }
+  }
+}
\ No newline at end of file
@@ -0,0 +1,238 @@
+#include "Profiler.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <iomanip>
+#include <ostream>
+#include <string>
+#include <string_view>
+
+#include "TaskGraph.hpp"
+
+std::atomic<bool> Profiler::_enabled{false};
+thread_local Profiler::Ring* Profiler::_tlsRing = nullptr;
+thread_local std::string Profiler::_tlsThreadName;
+
+static const std::chrono::steady_clock::time_point ProfilerEpoch = std::chrono::steady_clock::now();
+
+Profiler& Profiler::instance() {
+  static Profiler profiler;
+  return profiler;
+}
+
+uint64_t Profiler::now() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - ProfilerEpoch).count();
+}
+
+void Profiler::setThreadName(std::string name) {
+  _tlsThreadName = std::move(name);
+  if (_tlsRing) {
+    std::lock_guard lock(instance()._mutex);
+    _tlsRing->threadName = _tlsThreadName;
+  }
+}
+
+void Profiler::record(ProfileCategory category, const char* name, uint64_t begin, uint64_t end, const void* owner, uint32_t id) {
+  Ring& ring = localRing();
+  const uint64_t slot = ring.written.load(std::memory_order_relaxed);
+  ring.events[slot % RingCapacity] = ProfileEvent{name, owner, begin, end, frame(), ring.index, id, category};
+  ring.written.store(slot + 1, std::memory_order_release);
+}
+
+Profiler::Ring& Profiler::localRing() {
+  if (!_tlsRing) {
+    std::lock_guard lock(_mutex);
+    auto ring = std::make_unique<Ring>();
+    ring->index = static_cast<uint32_t>(_rings.size());
+    ring->threadName = _tlsThreadName.empty() ? "thread " + std::to_string(ring->index) : _tlsThreadName;
+    _tlsRing = ring.get();
+    _rings.push_back(std::move(ring));
+  }
+  return *_tlsRing;
+}
+
+std::vector<ProfileEvent> Profiler::events(uint32_t first, uint32_t last) const {
+  std::vector<ProfileEvent> result;
+  std::lock_guard lock(_mutex);
+  for (const auto& ring : _rings) {
+    const uint64_t written = ring->written.load(std::memory_order_acquire);
+    const uint64_t oldest = written > RingCapacity ? written - RingCapacity : 0;
+    for (uint64_t slot = oldest; slot < written; ++slot) {
+      const ProfileEvent& event = ring->events[slot % RingCapacity];
+      if (event.frame >= first && event.frame <= last) {
+        result.push_back(event);
+      }
+    }
+  }
+  std::sort(result.begin(), result.end(), [](const ProfileEvent& a, const ProfileEvent& b) { return a.begin < b.begin; });
+  return result;
+}
+
+static const char* categoryName(ProfileCategory category) {
+  switch (category) {
+    case ProfileCategory::Task:
+      return "task";
+    case ProfileCategory::System:
+      return "system";
+    case ProfileCategory::Idle:
+      return "idle";
+  }
+  return "";
+}
+
+static void writeJsonString(std::ostream& out, std::string_view text) {
+  out << '"';
+  for (char c : text) {
+    if (c == '"' || c == '\\') {
+      out << '\\' << c;
+    } else if (static_cast<unsigned char>(c) < 0x20) {
+      out << ' ';
+    } else {
+      out << c;
+    }
+  }
+  out << '"';
+}
+
+void Profiler::writeChromeTrace(std::ostream& out, uint32_t first, uint32_t last) const {
+  const std::vector<ProfileEvent> recorded = events(first, last);
+  const auto flags = out.flags();
+  out << std::fixed << std::setprecision(3) << "{\"traceEvents\":[";
+
+  bool separator = false;
+  {
+    std::lock_guard lock(_mutex);
+    for (const auto& ring : _rings) {
+      out << (separator ? ",\n" : "\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":" << ring->index
+          << ",\"args\":{\"name\":";
+      writeJsonString(out, ring->threadName);
+      out << "}}";
+      separator = true;
+    }
+  }
+
+  for (const ProfileEvent& event : recorded) {
+    out << (separator ? ",\n" : "\n") << "{\"name\":";
+    writeJsonString(out, event.name);
+    out << ",\"cat\":\"" << categoryName(event.category) << "\",\"ph\":\"X\",\"pid\":0,\"tid\":" << event.thread
+        << ",\"ts\":" << event.begin / 1000.0 << ",\"dur\":" << (event.end - event.begin) / 1000.0
+        << ",\"args\":{\"frame\":" << event.frame << "}}";
+    separator = true;
+  }
+  out << "\n]}\n";
+  out.flags(flags);
+}
+
+ProfileSummary Profiler::summarize(const TaskGraph& graph, uint32_t frame) const {
+  const std::vector<ProfileEvent> recorded = events(frame, frame);
+
+  ProfileSummary summary;
+  summary.frame = frame;
+
+  // Frame span and per task times of this graph
+  std::vector<uint64_t> taskTime(graph.size(), 0);
+  uint64_t frameBegin = UINT64_MAX, frameEnd = 0;
+  for (const ProfileEvent& event : recorded) {
+    if (event.category != ProfileCategory::Task || event.owner != &graph || event.id >= graph.size()) continue;
+    taskTime[event.id] += event.end - event.begin;
+    frameBegin = std::min(frameBegin, event.begin);
+    frameEnd = std::max(frameEnd, event.end);
+  }
+  if (frameBegin > frameEnd) {
+    return summary;
+  }
+  summary.frameTime = frameEnd - frameBegin;
+
+  // Longest path in topological order, a task starts once its slowest prerequisite is done
+  std::vector<size_t> pending(graph.size());
+  std::vector<size_t> ready;
+  for (size_t task = 0; task < graph.size(); ++task) {
+    pending[task] = graph.dependencyCount(TaskId{task});
+    if (pending[task] == 0) ready.push_back(task);
+  }
+  std::vector<uint64_t> start(graph.size(), 0), finish(graph.size(), 0);
+  std::vector<size_t> previous(graph.size(), SIZE_MAX);
+  size_t longest = SIZE_MAX;
+  while (!ready.empty()) {
+    const size_t task = ready.back();
+    ready.pop_back();
+    finish[task] = start[task] + taskTime[task];
+    if (longest == SIZE_MAX || finish[task] > finish[longest]) {
+      longest = task;
+    }
+    for (TaskId dependent : graph.dependents(TaskId{task})) {
+      if (previous[dependent.id] == SIZE_MAX || finish[task] > start[dependent.id]) {
+        start[dependent.id] = finish[task];
+        previous[dependent.id] = task;
+      }
+      if (--pending[dependent.id] == 0) ready.push_back(dependent.id);
+    }
+  }
+  if (longest != SIZE_MAX) {
+    summary.criticalPath = finish[longest];
+    for (size_t task = longest; task != SIZE_MAX; task = previous[task]) {
+      // Fanned out systems name their fork, chunk and join tasks alike
+      const char* name = graph.name(TaskId{task});
+      if (summary.criticalTasks.empty() || std::string_view(summary.criticalTasks.back()) != name) {
+        summary.criticalTasks.push_back(name);
+      }
+    }
+    std::reverse(summary.criticalTasks.begin(), summary.criticalTasks.end());
+  }
+
+  // System totals and thread busy/idle time, idle is clipped to the frame span. Only
+  // threads that took part in the frame are listed.
+  std::vector<std::string> threadNames;
+  {
+    std::lock_guard lock(_mutex);
+    for (const auto& ring : _rings) {
+      threadNames.push_back(ring->threadName);
+    }
+  }
+  std::vector<size_t> threadSlots(threadNames.size(), SIZE_MAX);
+  auto threadTime = [&](uint32_t thread) -> ProfileSummary::ThreadTime& {
+    if (threadSlots[thread] == SIZE_MAX) {
+      threadSlots[thread] = summary.threads.size();
+      summary.threads.push_back(ProfileSummary::ThreadTime{threadNames[thread], 0, 0});
+    }
+    return summary.threads[threadSlots[thread]];
+  };
+
+  for (const ProfileEvent& event : recorded) {
+    if (event.category == ProfileCategory::System) {
+      auto it = std::find_if(summary.systems.begin(), summary.systems.end(), [&](const ProfileSummary::SystemTime& system) {
+        return std::string_view(system.name) == event.name;
+      });
+      if (it == summary.systems.end()) {
+        it = summary.systems.insert(summary.systems.end(), ProfileSummary::SystemTime{event.name, 0, 0});
+      }
+      it->total += event.end - event.begin;
+      ++it->calls;
+    }
+    if (event.thread >= threadNames.size()) continue;
+    if (event.category == ProfileCategory::Task && event.owner == &graph) {
+      threadTime(event.thread).busy += event.end - event.begin;
+    } else if (event.category == ProfileCategory::Idle) {
+      const uint64_t begin = std::max(event.begin, frameBegin), end = std::min(event.end, frameEnd);
+      if (begin < end) threadTime(event.thread).idle += end - begin;
+    }
+  }
+  std::sort(summary.systems.begin(), summary.systems.end(), [](const auto& a, const auto& b) { return a.total > b.total; });
+  std::sort(summary.threads.begin(), summary.threads.end(), [](const auto& a, const auto& b) { return a.name < b.name; });
+  return summary;
+}
+
+void ProfileSummary::print(std::ostream& out) const {
+  out << "Frame " << frame << ": " << frameTime / 1000 << "us, critical path " << criticalPath / 1000 << "us";
+  for (size_t i = 0; i < criticalTasks.size(); ++i) {
+    out << (i == 0 ? " (" : " -> ") << criticalTasks[i];
+  }
+  out << (criticalTasks.empty() ? "\n" : ")\n");
+  for (const SystemTime& system : systems) {
+    out << "  " << system.name << ": " << system.total / 1000 << "us in " << system.calls << " calls\n";
+  }
+  for (const ThreadTime& thread : threads) {
+    out << "  " << thread.name << ": busy " << thread.busy / 1000 << "us, idle " << thread.idle / 1000 << "us\n";
+  }
+}
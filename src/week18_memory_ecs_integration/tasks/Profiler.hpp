@@ -0,0 +1,138 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <iosfwd>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+class TaskGraph;
+
+enum class ProfileCategory : uint8_t { Task, System, Idle };
+
+struct ProfileEvent {
+  const char* name;    // has to outlive the profiler, e.g. a literal or System::name()
+  const void* owner;   // the TaskGraph of a Task event
+  uint64_t begin;      // ns since the profiler was created
+  uint64_t end;
+  uint32_t frame;
+  uint32_t thread;
+  uint32_t id;         // TaskId of a Task event
+  ProfileCategory category;
+};
+
+struct ProfileSummary {
+  struct SystemTime {
+    const char* name;
+    uint64_t total;
+    uint32_t calls;
+  };
+  struct ThreadTime {
+    std::string name;
+    uint64_t busy;
+    uint64_t idle;
+  };
+
+  uint32_t frame = 0;
+  // First task start to last task end
+  uint64_t frameTime = 0;
+  // Longest dependency chain through the graph by measured task time
+  uint64_t criticalPath = 0;
+  std::vector<const char*> criticalTasks;
+  // Slowest first
+  std::vector<SystemTime> systems;
+  std::vector<ThreadTime> threads;
+
+  void print(std::ostream& out) const;
+};
+
+//
+//  Frame profiler
+//
+//  Every thread records into a ring of its own, so recording is two clock reads and a
+//  store without any locking. Rings overwrite their oldest events once full. Reading
+//  the events (traces, summaries) expects every recording thread to be idle, i.e. it
+//  has to happen between frames.
+//
+//  Disabled by default, instrumented code then only pays for one relaxed load.
+//
+class Profiler {
+ public:
+  static constexpr size_t RingCapacity = 1 << 14;
+
+  static Profiler& instance();
+
+  static bool enabled() { return _enabled.load(std::memory_order_relaxed); }
+  static void setEnabled(bool enabled) { _enabled.store(enabled, std::memory_order_relaxed); }
+  static uint64_t now();
+
+  // Names the calling thread in traces and summaries
+  static void setThreadName(std::string name);
+
+  void record(ProfileCategory category, const char* name, uint64_t begin, uint64_t end,
+              const void* owner = nullptr, uint32_t id = 0);
+
+  // Called by JobSystem::beginFrame, events are stamped with the current frame
+  void nextFrame() { _frame.fetch_add(1, std::memory_order_relaxed); }
+  uint32_t frame() const { return _frame.load(std::memory_order_relaxed); }
+
+  // Events of the frames [first, last] still held by the rings, ordered by begin
+  std::vector<ProfileEvent> events(uint32_t first, uint32_t last) const;
+
+  // Chrome trace-event JSON (chrome://tracing, Perfetto) of the frames [first, last]
+  void writeChromeTrace(std::ostream& out, uint32_t first, uint32_t last) const;
+
+  // Per system and per thread times of one frame plus the critical path through the
+  // graph it executed
+  ProfileSummary summarize(const TaskGraph& graph, uint32_t frame) const;
+
+ private:
+  struct Ring {
+    uint32_t index = 0;
+    std::string threadName;
+    std::unique_ptr<ProfileEvent[]> events = std::make_unique<ProfileEvent[]>(RingCapacity);
+    std::atomic<uint64_t> written{0};
+  };
+
+  Profiler() = default;
+
+  static std::atomic<bool> _enabled;
+  static thread_local Ring* _tlsRing;
+  static thread_local std::string _tlsThreadName;
+
+  std::atomic<uint32_t> _frame{0};
+  mutable std::mutex _mutex;
+  std::vector<std::unique_ptr<Ring>> _rings;
+
+  Ring& localRing();
+};
+
+// Records the enclosing scope if the profiler was enabled when it was entered
+class ProfileScope {
+ public:
+  ProfileScope(ProfileCategory category, const char* name, const void* owner = nullptr, uint32_t id = 0)
+      : _category(category), _name(name), _owner(owner), _id(id), _active(Profiler::enabled()) {
+    if (_active) {
+      _begin = Profiler::now();
+    }
+  }
+
+  ~ProfileScope() {
+    if (_active) {
+      Profiler::instance().record(_category, _name, _begin, Profiler::now(), _owner, _id);
+    }
+  }
+
+  ProfileScope(const ProfileScope&) = delete;
+  ProfileScope& operator=(const ProfileScope&) = delete;
+
+ private:
+  ProfileCategory _category;
+  const char* _name;
+  const void* _owner;
+  uint32_t _id;
+  bool _active;
+  uint64_t _begin = 0;
+};
@@ -1,25 +1,15 @@
 #include "TaskGraph.hpp"
 
 void TaskGraph::addDependency(TaskId dependent, TaskId prerequisite) {
-  auto& depNode = _tasks.at(dependent);
-  auto& prereqNode = _tasks.at(prerequisite);
+  auto& depNode = _tasks.at(dependent.id);
+  auto& prereqNode = _tasks.at(prerequisite.id);
   depNode.remainingDependencies.fetch_add(1, std::memory_order_relaxed);
+  ++depNode.dependencyCount;
   prereqNode.dependents.push_back(dependent);
 }
 
-std::vector<std::pair<TaskId, Job<>>> TaskGraph::fetchReadyJobs() {
-  std::vector<std::pair<TaskId, Job<>>> ready;
-  for (auto& [id, node] : _tasks) {
-    if (node.remainingDependencies.load(std::memory_order_relaxed) == 0 && !node.submitted) {
-      node.submitted = true;
-      ready.emplace_back(id, std::move(node.job));
-    }
-  }
-  return ready;
-}
-
 TaskId TaskGraph::generateTaskId() {
-  return TaskId{_nextId++};
+  return TaskId{_tasks.size()};
 }
 
 bool TaskGraph::isComplete() const {
@@ -27,12 +17,25 @@ bool TaskGraph::isComplete() const {
 }
 
 void TaskGraph::onTaskComplete(TaskId id) {
-  auto& node = _tasks.at(id);
+  auto& node = _tasks[id.id];
 
   for (TaskId dependentId : node.dependents) {
-    auto& depNode = _tasks.at(dependentId);
+    auto& depNode = _tasks[dependentId.id];
     depNode.remainingDependencies.fetch_sub(1, std::memory_order_acq_rel);
   }
 
   _remainingTasks.fetch_sub(1, std::memory_order_release);
-}
\ No newline at end of file
+}
+
+void TaskGraph::reset() {
+  for (TaskNode& node : _tasks) {
+    node.remainingDependencies.store(node.dependencyCount, std::memory_order_relaxed);
+    node.submitted = false;
+  }
+  _remainingTasks.store(_tasks.size(), std::memory_order_release);
+}
+
+void TaskGraph::clear() {
+  _tasks.clear();
+  _remainingTasks.store(0, std::memory_order_release);
+}
@@ -1,62 +1,95 @@
 #pragma once
 
 #include <atomic>
+#include <deque>
 #include <functional>
-#include <unordered_map>
+#include <span>
 #include <utility>
 #include <vector>
 
 #include "../async/Job.hpp"
 #include "../async/LockFreeQueue.hpp"
+#include "Profiler.hpp"
 #include "TaskId.hpp"
 
 struct TaskNode {
   Job<> job;
+  const char* name = "Task";
   std::atomic<size_t> remainingDependencies = 0;
+  size_t dependencyCount = 0;
   std::vector<TaskId> dependents;
   bool submitted = false;
 };
 
+//
+//  A DAG of jobs. Tasks keep their job after running, so a graph built once can be
+//  re-armed with reset() and executed again every frame without rebuilding it.
+//  Tasks capture the graph, which therefore stays where it was built. Every run of a
+//  task is recorded with the Profiler under the task's name.
+//
 class TaskGraph {
  public:
   TaskGraph() = default;
   ~TaskGraph() = default;
+  TaskGraph(const TaskGraph&) = delete;
+  TaskGraph& operator=(const TaskGraph&) = delete;
 
+  // name has to outlive the graph, e.g. a literal or System::name()
   template <typename Fn>
-  TaskId addTask(Fn&& func);
+  TaskId addTask(Fn&& func, const char* name = "Task");
   void addDependency(TaskId dependent, TaskId prerequisite);
-  std::vector<std::pair<TaskId, Job<>>> fetchReadyJobs();
+
+  // Hands every task whose prerequisites are done to submit(Job<>&&), once per run
+  template <typename Fn>
+  void submitReadyJobs(Fn&& submit);
 
   void onTaskComplete(TaskId id);
   bool isComplete() const;
 
+  // Re-arms every dependency counter for the next run. The graph must not be running.
+  void reset();
+  // Drops every task
+  void clear();
+
+  size_t size() const { return _tasks.size(); }
+  const char* name(TaskId id) const { return _tasks[id.id].name; }
+  std::span<const TaskId> dependents(TaskId id) const { return _tasks[id.id].dependents; }
+  size_t dependencyCount(TaskId id) const { return _tasks[id.id].dependencyCount; }
+
  private:
-  std::unordered_map<TaskId, TaskNode> _tasks;
+  // Deque keeps nodes in place as tasks are added, the atomics cannot move
+  std::deque<TaskNode> _tasks;
   std::atomic<size_t> _remainingTasks{0};
-  std::atomic<size_t> _nextId{0};
   TaskId generateTaskId();
 };
 
 template <typename Fn>
-TaskId TaskGraph::addTask(Fn&& func) {
+TaskId TaskGraph::addTask(Fn&& func, const char* name) {
   TaskId taskId = generateTaskId();
 
-  Job<> job;
-  job.set([this, taskId, func = std::move(func)]() {
-    func();
+  TaskNode& node = _tasks.emplace_back();
+  node.name = name;
+  node.job.set([this, taskId, name, func = std::move(func)]() {
+    {
+      ProfileScope scope(ProfileCategory::Task, name, this, static_cast<uint32_t>(taskId.id));
+      func();
+    }
     onTaskComplete(taskId);
   });
 
-  TaskNode node;
-  node.job = std::move(job);
-
-  _tasks.try_emplace(
-      taskId,
-      std::move(node.job),
-      node.remainingDependencies.load(),
-      std::move(node.dependents));
-
   _remainingTasks.fetch_add(1, std::memory_order_relaxed);
 
   return taskId;
-}
\ No newline at end of file
+}
+
+template <typename Fn>
+void TaskGraph::submitReadyJobs(Fn&& submit) {
+  for (TaskNode& node : _tasks) {
+    if (node.remainingDependencies.load(std::memory_order_acquire) == 0 && !node.submitted) {
+      node.submitted = true;
+      Job<> job;
+      job.set([&node]() { node.job(); });
+      submit(std::move(job));
+    }
+  }
+}